@@ -1,12 +1,16 @@
 #include "srm/count.hpp"
 #include "srm/report.hpp"
 #include "srm/table.hpp"
+#include "srm/mmap.hpp"
 
 #include "testutil.hpp"
 
 #include <sstream>
-#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <climits>
+#include <memory>
+#include <system_error>
 
 // Program that reads text of length n as input and repeats the following:
 // Select two a substring length s in [0, n / 2] and two substrings Y and Z,
@@ -18,35 +22,13 @@
 //   - Time to count
 //   - Time to report
 //   - Time to table
-// The number of iterations can be limited by a command line argument.
-
-/// Gets the current processor time in seconds. Linux specific, implement for
-/// other platforms.
-double getCPUTime() {
-	timespec t;
-	if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t)) {
-		fail("Measuring CPU time failed.");
-	}
-	return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
-}
-
-class Timer {
-public:
-	Timer() {
-		reset();
-	}
-	
-	void reset() {
-		start = getCPUTime();
-	}
-	
-	double getElapsedTime() {
-		return getCPUTime() - start;
-	}
-	
-private:
-	double start;
-};
+// The number of iterations can be limited by a command line argument. With
+// option --mmap, the text is memory-mapped lazily from the given file instead
+// of being read from standard input, and with option --mmap-populate, the
+// mapped file is read to memory while loading. The wall clock time used for
+// loading the text, the total wall clock time and the peak resident set size
+// are printed to standard error. With a lazy mapping, the pages are read in
+// during the first iterations, so the total time is the fair comparison.
 
 /// Simple O(n log n) suffix array construction taken from:
 ///   http://github.com/ttalvitie/libcontest
@@ -132,28 +114,68 @@ vector<int> constructSuffixArray(const string& S) {
 }
 
 int main(int argc, char* argv[]) {
-	// Read limit from command line.
+	// Read options and limit from command line.
+	string usage = "Usage: ./benchmark [--mmap file | --mmap-populate file] [iteration limit].";
+	int arg = 1;
+	string mmap_path;
+	bool populate = false;
+	if(arg < argc && (string(argv[arg]) == "--mmap" || string(argv[arg]) == "--mmap-populate")) {
+		if(arg + 1 >= argc) fail(usage);
+		populate = string(argv[arg]) == "--mmap-populate";
+		mmap_path = argv[arg + 1];
+		arg += 2;
+	}
 	int64_t limit = -1;
-	if(argc > 1) {
-		stringstream ss(argv[1]);
+	if(arg < argc) {
+		stringstream ss(argv[arg]);
 		ss >> limit;
-		if(ss.fail() || ss.bad() || !ss.eof() || argc > 2) {
-			fail("Usage: ./benchmark [iteration limit].");
+		if(ss.fail() || ss.bad() || !ss.eof() || arg + 1 < argc) {
+			fail(usage);
 		}
 	}
 	
-	// Read input text.
+	WallTimer total_timer;
+	WallTimer load_timer;
+	
+	// Read input text, either by mapping the file or from standard input.
 	string text;
-	char buf[4096];
-	while(cin.good()) {
-		cin.read(buf, 4096);
-		text.append(buf, cin.gcount());
+	unique_ptr<srm::MappedFile> mapped;
+	const char* text_begin;
+	const char* text_end;
+	if(!mmap_path.empty()) {
+		try {
+			mapped.reset(new srm::MappedFile(mmap_path, populate));
+		} catch(const system_error& e) {
+			fail(e.what());
+		}
+		text_begin = mapped->begin();
+		text_end = mapped->end();
+		
+		// Touch every page in case MAP_POPULATE is not supported, so that the
+		// page-ins are included in the loading time.
+		if(populate) {
+			size_t page = (size_t)sysconf(_SC_PAGESIZE);
+			volatile char touched = 0;
+			for(size_t i = 0; i < mapped->size(); i += page) {
+				touched = touched + text_begin[i];
+			}
+		}
+	} else {
+		char buf[4096];
+		while(cin.good()) {
+			cin.read(buf, 4096);
+			text.append(buf, cin.gcount());
+		}
+		if(cin.bad() || !cin.eof()) fail("Reading input failed.");
+		text_begin = text.data();
+		text_end = text_begin + text.size();
 	}
-	if(cin.bad() || !cin.eof()) fail("Reading input failed.");
 	
-	size_t n = text.size();
+	size_t n = text_end - text_begin;
 	if(n == 0) fail("Empty text is not supported.");
 	
+	cerr << "Loading text took " << load_timer.getElapsedTime() << " s.\n";
+	
 	size_t log_n = 0;
 	while(((size_t)1 << log_n) < n) ++log_n;
 	
@@ -163,9 +185,9 @@ int main(int argc, char* argv[]) {
 		size_t a = rand((size_t)0, n - s);
 		size_t b = rand((size_t)0, n - s);
 		
-		auto y_begin = text.begin() + a;
+		auto y_begin = text_begin + a;
 		auto y_end = y_begin + s;
-		auto z_begin = text.begin() + b;
+		auto z_begin = text_begin + b;
 		auto z_end = z_begin + s;
 		
 		// Make sure that Y <= Z.
@@ -188,7 +210,7 @@ int main(int argc, char* argv[]) {
 		
 		size_t count_result =
 			srm::makeRangeCounter(y_begin, y_end, z_begin, z_end)
-				.count(text.begin(), text.end());
+				.count(text_begin, text_end);
 		
 		double count_time = timer.getElapsedTime();
 		
@@ -199,7 +221,7 @@ int main(int argc, char* argv[]) {
 		timer.reset();
 		
 		srm::reportRangeMatches(
-			text.begin(), text.end(),
+			text_begin, text_end,
 			y_begin, y_end,
 			z_begin, z_end,
 			[&](size_t i) { report_result.push_back(i); }
@@ -213,7 +235,7 @@ int main(int argc, char* argv[]) {
 		timer.reset();
 		
 		srm::computeRangeMatchTableToIterator(
-			text.begin(), text.end(),
+			text_begin, text_end,
 			y_begin, y_end,
 			z_begin, z_end,
 			table_result.begin()
@@ -238,5 +260,10 @@ int main(int argc, char* argv[]) {
 		cout << s << " " << count_result << " " << lcp << " " << count_time << " " << report_time << " " << table_time << "\n";
 	}
 	
+	rusage usage_info;
+	if(getrusage(RUSAGE_SELF, &usage_info)) fail("Measuring peak memory usage failed.");
+	cerr << "Total time " << total_timer.getElapsedTime() << " s.\n";
+	cerr << "Peak resident set size " << usage_info.ru_maxrss << " kB.\n";
+	
 	return 0;
 }
@@ -1,5 +1,6 @@
 #/bin/bash
 
-g++ randomtest.cpp -o randomtest -O2 -Wall -g -std=c++0x
-g++ smalltest.cpp -o smalltest -O2 -Wall -g -std=c++0x
-g++ benchmark.cpp -o benchmark -DNDEBUG -O2 -Wall -g -std=c++0x -lrt
+g++ randomtest.cpp -o randomtest -O2 -Wall -g -std=c++0x -pthread
+g++ smalltest.cpp -o smalltest -O2 -Wall -g -std=c++0x -pthread
+g++ benchmark.cpp -o benchmark -DNDEBUG -O2 -Wall -g -std=c++0x -pthread -lrt
+g++ microbenchmark.cpp -o microbenchmark -DNDEBUG -O2 -Wall -g -std=c++0x -pthread -lrt
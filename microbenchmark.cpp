@@ -0,0 +1,995 @@
+#include "srm/count.hpp"
+#include "srm/pattern.hpp"
+#include "srm/report.hpp"
+#include "srm/bitvector.hpp"
+#include "srm/mmap.hpp"
+#include "srm/stream.hpp"
+
+#include "testutil.hpp"
+
+#include <map>
+#include <functional>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
+// Micro-benchmarks measuring the costs of individual parts of the range
+// matching algorithms on generated texts of 16 megabytes:
+//   - random: random text in alphabet of size 4
+//   - fib: Fibonacci string, very repetitive
+//   - noisy: random string of length 1000 repeated, with 1% of the characters
+//     replaced by random characters
+// Run as ./microbenchmark [benchmark name...]. Without arguments, runs all the
+// benchmarks. Each benchmark prints lines of the form
+//   benchmark text |Y| measurement
+// where the measurement is time in nanoseconds unless stated otherwise.
+
+const size_t text_length = (size_t)1 << 24;
+
+/// Return the prefix of given length of the Fibonacci string.
+string fibonacciString(size_t length) {
+	string a = "b";
+	string b = "a";
+	while(b.size() < length) {
+		string c = b + a;
+		a.swap(b);
+		b.swap(c);
+	}
+	b.resize(length);
+	return b;
+}
+
+/// Return the generated texts by name.
+const map<string, string>& texts() {
+	static map<string, string> ret;
+	if(ret.empty()) {
+		ret["random"] = randstring(text_length, 'a', 'd');
+		ret["fib"] = fibonacciString(text_length);
+		
+		string noisy = randstring(1000, 'a', 'd');
+		while(noisy.size() < text_length) noisy += noisy;
+		noisy.resize(text_length);
+		for(char& c : noisy) {
+			if(rand(0, 99) == 0) c = rand('a', 'd');
+		}
+		ret["noisy"] = noisy;
+	}
+	return ret;
+}
+
+/// Lengths of Y used in the benchmarks.
+const vector<size_t> y_lengths = {4, 64, 4096, 262144};
+
+/// Number of different substrings Y measured for each length.
+const int samples = 5;
+
+/// Return a random substring of length m of text X.
+string randomSubstring(const string& X, size_t m) {
+	return X.substr(rand((size_t)0, X.size() - m), m);
+}
+
+/// Return random substrings Y and Z of length m of text X such that Y <= Z.
+pair<string, string> randomRange(const string& X, size_t m) {
+	string Y = randomSubstring(X, m);
+	string Z = randomSubstring(X, m);
+	if(Y > Z) swap(Y, Z);
+	return make_pair(Y, Z);
+}
+
+/// Print the per-character time of LessThanCounter::count as benchmark name,
+/// with Y selected as a random substring of the text. The counter for Y is
+/// constructed by make_counter(y_begin, y_end).
+template <typename F>
+void measureCount(const string& name, F make_counter) {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			Timer timer;
+			size_t total = 0;
+			for(int t = 0; t < samples; ++t) {
+				size_t a = rand((size_t)0, X.size() - m);
+				auto counter = make_counter(X.begin() + a, X.begin() + a + m);
+				total += counter.count(X.begin(), X.end());
+			}
+			double time = timer.getElapsedTime();
+			if(total > samples * X.size()) fail("Invalid count.");
+			
+			cout << name << " " << text.first << " " << m << " ";
+			cout << 1e9 * time / (samples * X.size()) << "\n";
+		}
+	}
+}
+
+typedef string::const_iterator SI;
+
+/// Default LessThanCounter with k = 3.
+void benchmarkCount() {
+	measureCount("count", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end);
+	});
+}
+
+/// LessThanCounter with k given at run time and at compile time.
+void benchmarkCountK() {
+	measureCount("count-k4", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end, (size_t)4);
+	});
+	measureCount("count-K4", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter<4>(y_begin, y_end);
+	});
+	measureCount("count-k8", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end, (size_t)8);
+	});
+	measureCount("count-K8", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter<8>(y_begin, y_end);
+	});
+}
+
+/// LessThanCounter with 32-bit indices.
+void benchmarkCountIdx32() {
+	measureCount("count-idx32", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end, (uint32_t)3);
+	});
+}
+
+/// Return the nested cube string of given length: the prefix of length m of
+/// S_t for large enough t, where S_0 = a and S_{t + 1} = S_t S_t S_t c_t with
+/// c_t cycling through b, c and d. Its prefixes have many periods of exponent
+/// 3 but not 4, so that Sp for k = 3 has an entry for each of them, and Sp for
+/// larger k has none.
+string nestedCubeString(size_t length) {
+	string ret = "a";
+	char c = 'b';
+	while(ret.size() < length) {
+		ret = ret + ret + ret + c;
+		c = c == 'd' ? 'b' : c + 1;
+	}
+	ret.resize(length);
+	return ret;
+}
+
+/// LessThanCounter with each of the candidate values of k of the automatic
+/// selection of k, and with the automatic selection. Prints also the chosen k
+/// for a random substring of each length as benchmark count-k-auto-choice.
+/// Used to fit and check the cost model of the automatic selection.
+///
+/// In addition, the same is measured for text "tandem": random text with the
+/// nested cube string of length 1024 written at every multiple of 65536, with
+/// Y starting at one of them. There the Sp entries for k = 3 help only in the
+/// nested cube strings, and the automatic selection chooses a larger k, which
+/// is faster as the binary search over Sp is skipped in the random parts.
+void benchmarkCountKAuto() {
+	for(size_t k : {3, 4, 6, 8}) {
+		measureCount("count-k-auto-" + to_string(k), [k](SI y_begin, SI y_end) {
+			return srm::makeLessThanCounter(y_begin, y_end, k);
+		});
+	}
+	measureCount("count-k-auto", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end, (size_t)0);
+	});
+	
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			size_t a = rand((size_t)0, X.size() - m);
+			auto counter = srm::makeLessThanCounter(X.begin() + a, X.begin() + a + m, (size_t)0);
+			cout << "count-k-auto-choice " << text.first << " " << m << " ";
+			cout << counter.getK() << "\n";
+		}
+	}
+	
+	const size_t block_interval = 65536;
+	string tandem = randstring(text_length, 'a', 'd');
+	string block = nestedCubeString(1024);
+	for(size_t i = 0; i < tandem.size(); i += block_interval) {
+		tandem.replace(i, block.size(), block);
+	}
+	for(size_t m : {4096, 65536}) {
+		vector<string> Ys;
+		for(int t = 0; t < samples; ++t) {
+			size_t a = block_interval * rand((size_t)0, tandem.size() / block_interval - 2);
+			Ys.push_back(tandem.substr(a, m));
+		}
+		for(size_t k : {3, 4, 6, 8, 0}) {
+			Timer timer;
+			size_t total = 0;
+			for(const string& Y : Ys) {
+				auto counter = srm::makeLessThanCounter(Y.cbegin(), Y.cend(), k);
+				total += counter.count(tandem.begin(), tandem.end());
+			}
+			double time = timer.getElapsedTime();
+			if(total > samples * tandem.size()) fail("Invalid count.");
+			
+			cout << "count-k-auto" << (k != 0 ? "-" + to_string(k) : "") << " tandem " << m << " ";
+			cout << 1e9 * time / (samples * tandem.size()) << "\n";
+		}
+		auto counter = srm::makeLessThanCounter(Ys[0].cbegin(), Ys[0].cend(), (size_t)0);
+		cout << "count-k-auto-choice tandem " << m << " " << counter.getK() << "\n";
+	}
+}
+
+/// Return the thread counts measured by the parallel benchmarks: 1, 2, 4, ...
+/// up to the number of hardware threads, but at least up to 4, so that the
+/// cost of splitting the work is shown also on machines with few threads.
+vector<unsigned> threadCounts() {
+	unsigned max_threads = max(4u, thread::hardware_concurrency());
+	vector<unsigned> ret;
+	for(unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+		ret.push_back(thread_count);
+	}
+	return ret;
+}
+
+/// Per-character time of LessThanCounter::count (count-threadsT) and
+/// RangeCounter::count (count-range-threadsT) over the whole text in T threads
+/// for T in threadCounts(), with Y and Z selected as random substrings of the
+/// text. The time is wall clock time, so that it shows the speedup.
+void benchmarkCountThreads() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096, 262144}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			auto counter = srm::makeLessThanCounter(Y.cbegin(), Y.cend());
+			auto range_counter = srm::makeRangeCounter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			
+			size_t expected = 0;
+			size_t range_expected = 0;
+			for(unsigned thread_count : threadCounts()) {
+				WallTimer timer;
+				size_t count = counter.count(X.begin(), X.end(), thread_count);
+				double time = timer.getElapsedTime();
+				
+				timer.reset();
+				size_t range_count = range_counter.count(X.begin(), X.end(), thread_count);
+				double range_time = timer.getElapsedTime();
+				
+				if(thread_count == 1) {
+					expected = count;
+					range_expected = range_count;
+				}
+				if(count != expected || range_count != range_expected) {
+					fail("Parallel counts disagree.");
+				}
+				
+				cout << "count-threads" << thread_count << " " << text.first << " " << m << " ";
+				cout << 1e9 * time / X.size() << "\n";
+				cout << "count-range-threads" << thread_count << " " << text.first << " " << m << " ";
+				cout << 1e9 * range_time / X.size() << "\n";
+			}
+		}
+	}
+}
+
+/// Per-character and per-range time of counting 16 ranges with Y and Z
+/// selected as random substrings of the text, with a separate
+/// RangeCounter::count call for each range (batch-separate) and with
+/// countRangeMatchesBatch in T threads for T in threadCounts()
+/// (batch-threadsT). The time is wall clock time.
+void benchmarkBatch() {
+	const size_t range_count = 16;
+	typedef srm::RangeCounter<SI, SI> Counter;
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096}) {
+			vector<string> bounds;
+			vector<Counter> counters;
+			bounds.reserve(2 * range_count);
+			for(size_t j = 0; j < range_count; ++j) {
+				string Y, Z;
+				tie(Y, Z) = randomRange(X, m);
+				bounds.push_back(Y);
+				bounds.push_back(Z);
+				counters.emplace_back(
+					bounds[2 * j].cbegin(), bounds[2 * j].cend(),
+					bounds[2 * j + 1].cbegin(), bounds[2 * j + 1].cend()
+				);
+			}
+			
+			vector<size_t> expected;
+			WallTimer timer;
+			for(const Counter& counter : counters) {
+				expected.push_back(counter.count(X.begin(), X.end()));
+			}
+			double separate_time = timer.getElapsedTime();
+			
+			cout << "batch-separate " << text.first << " " << m << " ";
+			cout << 1e9 * separate_time / (range_count * X.size()) << "\n";
+			
+			for(unsigned thread_count : threadCounts()) {
+				timer.reset();
+				vector<size_t> counts = srm::countRangeMatchesBatch(X.begin(), X.end(), counters, thread_count);
+				double time = timer.getElapsedTime();
+				if(counts != expected) fail("Batch and separate counts disagree.");
+				
+				cout << "batch-threads" << thread_count << " " << text.first << " " << m << " ";
+				cout << 1e9 * time / (range_count * X.size()) << "\n";
+			}
+		}
+	}
+}
+
+/// Per-character and per-boundary time of counting the suffixes of the text in
+/// the buckets delimited by 16 sorted boundaries selected as random substrings
+/// of the text, with a separate LessThanCounter::count call for each boundary
+/// (buckets-separate) and with BucketCounter::count in T threads for T in
+/// threadCounts() (buckets-threadsT). The time is wall clock time.
+void benchmarkBuckets() {
+	const size_t boundary_count = 16;
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096}) {
+			vector<string> boundaries;
+			for(size_t j = 0; j < boundary_count; ++j) {
+				boundaries.push_back(randomSubstring(X, m));
+			}
+			sort(boundaries.begin(), boundaries.end());
+			boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+			vector<pair<SI, SI>> ranges;
+			for(const string& boundary : boundaries) {
+				ranges.emplace_back(boundary.cbegin(), boundary.cend());
+			}
+			
+			vector<size_t> expected(ranges.size() + 1);
+			WallTimer timer;
+			size_t prev = 0;
+			for(size_t j = 0; j < ranges.size(); ++j) {
+				size_t less = srm::makeLessThanCounter(ranges[j].first, ranges[j].second).count(X.begin(), X.end());
+				expected[j] = less - prev;
+				prev = less;
+			}
+			expected[ranges.size()] = X.size() - prev;
+			double separate_time = timer.getElapsedTime();
+			
+			cout << "buckets-separate " << text.first << " " << m << " ";
+			cout << 1e9 * separate_time / (ranges.size() * X.size()) << "\n";
+			
+			for(unsigned thread_count : threadCounts()) {
+				timer.reset();
+				vector<size_t> histogram = srm::makeBucketCounter(ranges).count(X.begin(), X.end(), thread_count);
+				double time = timer.getElapsedTime();
+				if(histogram != expected) fail("Bucket and separate counts disagree.");
+				
+				cout << "buckets-threads" << thread_count << " " << text.first << " " << m << " ";
+				cout << 1e9 * time / (ranges.size() * X.size()) << "\n";
+			}
+		}
+	}
+}
+
+/// Per-character time of counting with StreamingLessThanCounter, feeding the
+/// whole text in chunks of C characters (stream-chunkC) for C = 1, 16 and 4096,
+/// with Y selected as a random substring of the text. Text "unary" consisting
+/// of character 'a' only with Y = a^(|Y| - 1) b is measured in addition, as
+/// there every suffix shares a prefix of length |Y| - 1 with Y, so the scan must
+/// carry the common prefix over the chunks.
+void benchmarkStream() {
+	vector<pair<string, string>> cases;
+	for(const auto& text : texts()) {
+		for(size_t m : y_lengths) {
+			cases.emplace_back(text.first, randomSubstring(text.second, m));
+		}
+	}
+	string unary(text_length, 'a');
+	for(size_t m : y_lengths) {
+		cases.emplace_back("unary", string(m - 1, 'a') + "b");
+	}
+	
+	for(const auto& c : cases) {
+		const string& X = c.first == "unary" ? unary : texts().at(c.first);
+		const string& Y = c.second;
+		size_t expected = srm::makeLessThanCounter(Y.cbegin(), Y.cend()).count(X.begin(), X.end());
+		for(size_t chunk : {1, 16, 4096}) {
+			Timer timer;
+			auto counter = srm::makeStreamingLessThanCounter(Y.cbegin(), Y.cend());
+			for(size_t pos = 0; pos < X.size(); pos += chunk) {
+				counter.feed(X.data() + pos, min(chunk, X.size() - pos));
+			}
+			size_t count = counter.finish();
+			double time = timer.getElapsedTime();
+			if(count != expected) fail("Streaming and plain counts disagree.");
+			
+			cout << "stream-chunk" << chunk << " " << c.first << " " << Y.size() << " ";
+			cout << 1e9 * time / X.size() << "\n";
+		}
+	}
+}
+
+/// Print the time of constructing a counter using make_counter(y_begin, y_end)
+/// as benchmark name, with Y selected as a random substring of the text. The
+/// substrings are selected from the beginning of the text, so that the cost of
+/// cache misses in reading Y does not dominate for short Y.
+template <typename F>
+void measureConstruction(const string& name, F make_counter) {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			size_t reps = max((size_t)16, ((size_t)1 << 22) / m);
+			vector<size_t> starts;
+			for(size_t t = 0; t < reps; ++t) {
+				starts.push_back(rand((size_t)0, min(X.size() - m, (size_t)1 << 16)));
+			}
+			
+			Timer timer;
+			size_t total = 0;
+			for(size_t a : starts) {
+				auto counter = make_counter(X.begin() + a, X.begin() + a + m);
+				total += counter.count(X.begin() + a, X.begin() + a + 1);
+			}
+			double time = timer.getElapsedTime();
+			if(total > reps) fail("Invalid count.");
+			
+			cout << name << " " << text.first << " " << m << " ";
+			cout << 1e9 * time / reps << "\n";
+		}
+	}
+}
+
+/// Time of constructing LessThanCounter with heap and inline storage.
+void benchmarkConstruct() {
+	measureConstruction("construct", [](SI y_begin, SI y_end) {
+		return srm::makeLessThanCounter(y_begin, y_end);
+	});
+	measureConstruction("construct-inline", [](SI y_begin, SI y_end) {
+		return srm::makeInlineLessThanCounter(y_begin, y_end);
+	});
+	measureConstruction("construct-inline-idx32", [](SI y_begin, SI y_end) {
+		return srm::makeInlineLessThanCounter(y_begin, y_end, (uint32_t)3);
+	});
+}
+
+/// Per-pattern time of constructing PatternIndex objects for 1000 random
+/// substrings of the text (pattern-build) and of loading them from their
+/// serialized blobs (pattern-load).
+void benchmarkPatternIndex() {
+	const int pattern_count = 1000;
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			Timer timer;
+			vector<char> blobs;
+			for(int j = 0; j < pattern_count; ++j) {
+				size_t a = rand((size_t)0, X.size() - m);
+				srm::PatternIndex<char> index(X.begin() + a, X.begin() + a + m);
+				index.serialize(blobs);
+			}
+			double build_time = timer.getElapsedTime();
+			
+			vector<uint64_t> storage(blobs.size() / 8);
+			memcpy(storage.data(), blobs.data(), blobs.size());
+			
+			timer.reset();
+			auto indices = srm::loadPatternIndices<char>((const char*)storage.data(), blobs.size());
+			double load_time = timer.getElapsedTime();
+			if(indices.size() != pattern_count) fail("Invalid pattern count.");
+			
+			cout << "pattern-build " << text.first << " " << m << " ";
+			cout << 1e9 * build_time / pattern_count << "\n";
+			cout << "pattern-load " << text.first << " " << m << " ";
+			cout << 1e9 * load_time / pattern_count << "\n";
+		}
+	}
+}
+
+/// Per-character time of computing the range table of the whole text with Y and
+/// Z selected as random substrings of the text to a packed bitvector, by
+/// computing the less-than tables of Y and Z separately and combining them
+/// through a temporary table of |X| bits (table-range-temp), and with
+/// computeRangeMatchTableToWords (table-range-words).
+void benchmarkRangeTable() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			size_t word_count = srm::packedWordCount(X.size());
+			
+			vector<uint64_t> temp_words(word_count);
+			Timer timer;
+			srm::computeLessThanMatchTableToWords(X.begin(), X.end(), Y.cbegin(), Y.cend(), temp_words.data());
+			vector<uint64_t> tmp(word_count);
+			srm::computeLessThanMatchTableToWords(X.begin(), X.end(), Z.cbegin(), Z.cend(), tmp.data());
+			for(size_t w = 0; w < word_count; ++w) {
+				temp_words[w] ^= tmp[w];
+			}
+			double temp_time = timer.getElapsedTime();
+			
+			vector<uint64_t> words(word_count);
+			timer.reset();
+			srm::computeRangeMatchTableToWords(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend(), words.data()
+			);
+			double words_time = timer.getElapsedTime();
+			if(words != temp_words) fail("Range tables disagree.");
+			
+			cout << "table-range-temp " << text.first << " " << m << " ";
+			cout << 1e9 * temp_time / X.size() << "\n";
+			cout << "table-range-words " << text.first << " " << m << " ";
+			cout << 1e9 * words_time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of computing the range table of the whole text with Y and
+/// Z selected as random substrings of the text to a bitvector file with
+/// computeRangeMatchTableToFile (table-range-file), writing the file to the
+/// directory given by environment variable TMPDIR or /tmp. The time is wall
+/// clock time, so that it includes the time spent waiting for the writes.
+void benchmarkFileTable() {
+	const char* tmpdir = getenv("TMPDIR");
+	string path = string(tmpdir != nullptr ? tmpdir : "/tmp") + "/srm_microbenchmark_table";
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			
+			WallTimer timer;
+			srm::computeRangeMatchTableToFile(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend(), path
+			);
+			double time = timer.getElapsedTime();
+			
+			srm::MappedBitvector bitvector = srm::MappedBitvector::load(path);
+			remove(path.c_str());
+			if(bitvector.size() != X.size()) fail("Invalid bitvector file.");
+			
+			cout << "table-range-file " << text.first << " " << m << " ";
+			cout << 1e9 * time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of computeRangeMatchTableCompressed for the whole text
+/// with Y and Z selected as random substrings of the text
+/// (table-range-compressed), the size of the compressed table in bytes
+/// (table-range-compressed-bytes, compared to n / 8 bytes of the packed table)
+/// and the time per query of rank and select on it (table-range-rank,
+/// table-range-select).
+void benchmarkCompressedTable() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			
+			Timer timer;
+			srm::CompressedBitvector table = srm::computeRangeMatchTableCompressed(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend()
+			);
+			double time = timer.getElapsedTime();
+			
+			vector<uint64_t> words(srm::packedWordCount(X.size()));
+			srm::computeRangeMatchTableToWords(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend(), words.data()
+			);
+			size_t ones = 0;
+			for(uint64_t word : words) {
+				ones += srm::popCount(word);
+			}
+			if(table.size() != X.size() || table.count() != ones) fail("Invalid compressed table.");
+			
+			const size_t query_count = 1000000;
+			size_t rank_total = 0;
+			timer.reset();
+			for(size_t q = 0; q < query_count; ++q) {
+				rank_total += table.rank(rand((size_t)0, X.size()));
+			}
+			double rank_time = timer.getElapsedTime();
+			if(rank_total > query_count * ones) fail("Invalid rank.");
+			
+			size_t select_total = 0;
+			timer.reset();
+			if(ones != 0) {
+				for(size_t q = 0; q < query_count; ++q) {
+					select_total += table.select(rand((size_t)0, ones - 1));
+				}
+			}
+			double select_time = timer.getElapsedTime();
+			if(select_total > query_count * X.size()) fail("Invalid select.");
+			
+			cout << "table-range-compressed " << text.first << " " << m << " ";
+			cout << 1e9 * time / X.size() << "\n";
+			cout << "table-range-compressed-bytes " << text.first << " " << m << " ";
+			cout << table.byteSize() << "\n";
+			cout << "table-range-rank " << text.first << " " << m << " ";
+			cout << 1e9 * rank_time / query_count << "\n";
+			cout << "table-range-select " << text.first << " " << m << " ";
+			cout << 1e9 * select_time / query_count << "\n";
+		}
+	}
+}
+
+/// Per-character time of computeRangeMatchTableToWords for the whole text with
+/// Y and Z selected as random substrings of the text using T threads
+/// (table-range-threadsT), for T = 1, 2, 4, ... up to the number of hardware
+/// threads. The time is wall clock time, so that it shows the speedup.
+void benchmarkParallelTable() {
+	unsigned max_threads = max(1u, thread::hardware_concurrency());
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			
+			vector<uint64_t> expected;
+			for(unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+				vector<uint64_t> words(srm::packedWordCount(X.size()));
+				WallTimer timer;
+				srm::computeRangeMatchTableToWords(
+					X.begin(), X.end(), Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend(),
+					words.data(), thread_count
+				);
+				double time = timer.getElapsedTime();
+				if(thread_count == 1) expected = words;
+				if(words != expected) fail("Parallel tables disagree.");
+				
+				cout << "table-range-threads" << thread_count << " " << text.first << " " << m << " ";
+				cout << 1e9 * time / X.size() << "\n";
+			}
+		}
+	}
+}
+
+/// Per-character time of reporting range matches in the whole text with Y and Z
+/// selected as random substrings of the text, using reportRangeMatches (report)
+/// and RangeReporter (report-reporter).
+void benchmarkReport() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {4, 64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			
+			size_t count = 0;
+			Timer timer;
+			srm::reportRangeMatches(
+				X.begin(), X.end(),
+				Y.cbegin(), Y.cend(),
+				Z.cbegin(), Z.cend(),
+				[&](size_t) { ++count; }
+			);
+			double time = timer.getElapsedTime();
+			
+			size_t reporter_count = 0;
+			timer.reset();
+			auto reporter = srm::makeRangeReporter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			reporter.report(X.begin(), X.end(), [&](size_t) { ++reporter_count; });
+			double reporter_time = timer.getElapsedTime();
+			if(count != reporter_count) fail("Report and reporter disagree.");
+			
+			cout << "report " << text.first << " " << m << " ";
+			cout << 1e9 * time / X.size() << "\n";
+			cout << "report-reporter " << text.first << " " << m << " ";
+			cout << 1e9 * reporter_time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of counting the range matches in the whole text with
+/// RangeReporter using an output function taking single matches (report-count)
+/// and MatchCountOutput accepting runs of matches (report-count-runs), with Y
+/// and Z selected as random substrings of the text. The number of matches per
+/// character is printed as report-count-matches.
+void benchmarkReportRuns() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {4, 64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			auto reporter = srm::makeRangeReporter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			
+			size_t count = 0;
+			Timer timer;
+			reporter.report(X.begin(), X.end(), [&](size_t) { ++count; });
+			double time = timer.getElapsedTime();
+			
+			size_t run_count = 0;
+			timer.reset();
+			reporter.report(X.begin(), X.end(), srm::MatchCountOutput<>{run_count});
+			double run_time = timer.getElapsedTime();
+			if(count != run_count) fail("Report with and without runs disagree.");
+			
+			cout << "report-count " << text.first << " " << m << " ";
+			cout << 1e9 * time / X.size() << "\n";
+			cout << "report-count-runs " << text.first << " " << m << " ";
+			cout << 1e9 * run_time / X.size() << "\n";
+			cout << "report-count-matches " << text.first << " " << m << " ";
+			cout << (double)count / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of collecting the range matches in the whole text to a
+/// preallocated array with reportRangeMatches, calling push_back for each match
+/// (report-push) or writing spans of matches with ArraySink to arrays of 64-bit
+/// and 32-bit integers (report-spans64, report-spans32). Y is selected as a
+/// random substring of the text and Z is larger than all suffixes, so that
+/// about half of the suffixes match. The number of matches per character is
+/// printed as report-output-matches.
+void benchmarkReportOutput() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {4, 64, 4096}) {
+			string Y = randomSubstring(X, m);
+			string Z = "e";
+			
+			vector<size_t> result;
+			result.reserve(X.size() + 1);
+			Timer timer;
+			srm::reportRangeMatches(
+				X.begin(), X.end(),
+				Y.cbegin(), Y.cend(),
+				Z.cbegin(), Z.cend(),
+				[&](size_t i) { result.push_back(i); }
+			);
+			double push_time = timer.getElapsedTime();
+			
+			vector<uint64_t> result64(X.size() + 1);
+			size_t size64 = 0;
+			timer.reset();
+			srm::reportRangeMatchSpans(
+				X.begin(), X.end(),
+				Y.cbegin(), Y.cend(),
+				Z.cbegin(), Z.cend(),
+				srm::ArraySink<uint64_t>{result64.data(), size64}
+			);
+			double time64 = timer.getElapsedTime();
+			
+			vector<uint32_t> result32(X.size() + 1);
+			size_t size32 = 0;
+			timer.reset();
+			srm::reportRangeMatchSpans(
+				X.begin(), X.end(),
+				Y.cbegin(), Y.cend(),
+				Z.cbegin(), Z.cend(),
+				srm::ArraySink<uint32_t>{result32.data(), size32}
+			);
+			double time32 = timer.getElapsedTime();
+			
+			if(size64 != result.size() || size32 != result.size()) {
+				fail("Outputs disagree about the match count.");
+			}
+			
+			cout << "report-push " << text.first << " " << m << " ";
+			cout << 1e9 * push_time / X.size() << "\n";
+			cout << "report-spans64 " << text.first << " " << m << " ";
+			cout << 1e9 * time64 / X.size() << "\n";
+			cout << "report-spans32 " << text.first << " " << m << " ";
+			cout << 1e9 * time32 / X.size() << "\n";
+			cout << "report-output-matches " << text.first << " " << m << " ";
+			cout << (double)result.size() / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of collecting the range matches in the whole text in
+/// increasing order with RangeReporter, reporting them unordered and sorting
+/// them with std::sort (report-then-sort) or using reportSorted
+/// (report-sorted), with Y and Z selected as random substrings of the text.
+/// The number of matches per character is printed as report-sorted-matches.
+void benchmarkReportSorted() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {4, 64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			auto reporter = srm::makeRangeReporter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			
+			vector<size_t> result;
+			result.reserve(X.size() + 1);
+			Timer timer;
+			reporter.report(X.begin(), X.end(), [&](size_t i) { result.push_back(i); });
+			sort(result.begin(), result.end());
+			double sort_time = timer.getElapsedTime();
+			
+			vector<size_t> sorted_result;
+			sorted_result.reserve(X.size() + 1);
+			timer.reset();
+			reporter.reportSorted(X.begin(), X.end(), [&](size_t i) { sorted_result.push_back(i); });
+			double sorted_time = timer.getElapsedTime();
+			if(result != sorted_result) fail("Sorted outputs disagree.");
+			
+			cout << "report-then-sort " << text.first << " " << m << " ";
+			cout << 1e9 * sort_time / X.size() << "\n";
+			cout << "report-sorted " << text.first << " " << m << " ";
+			cout << 1e9 * sorted_time / X.size() << "\n";
+			cout << "report-sorted-matches " << text.first << " " << m << " ";
+			cout << (double)result.size() / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of queries on the whole text with RangeReporter that
+/// need only some of the matches, compared to reporting all of them
+/// (report-all): the first 10 matches with reportFirst (report-first10) and
+/// whether a match exists with exists (report-exists). Y and Z are selected as
+/// random substrings of the text.
+void benchmarkReportFirst() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {4, 64, 4096}) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			auto reporter = srm::makeRangeReporter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			
+			size_t count = 0;
+			Timer timer;
+			reporter.report(X.begin(), X.end(), srm::MatchCountOutput<>{count});
+			double all_time = timer.getElapsedTime();
+			
+			size_t sum = 0;
+			timer.reset();
+			size_t first_count = reporter.reportFirst(X.begin(), X.end(), 10, [&](size_t i) { sum += i; });
+			double first_time = timer.getElapsedTime();
+			
+			timer.reset();
+			bool exists = reporter.exists(X.begin(), X.end());
+			double exists_time = timer.getElapsedTime();
+			if(first_count != min(count, (size_t)10) || exists != (count != 0)) {
+				fail("Partial queries disagree with report.");
+			}
+			
+			cout << "report-all " << text.first << " " << m << " ";
+			cout << 1e9 * all_time / X.size() << "\n";
+			cout << "report-first10 " << text.first << " " << m << " ";
+			cout << 1e9 * first_time / X.size() << "\n";
+			cout << "report-exists " << text.first << " " << m << " ";
+			cout << 1e9 * exists_time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of computing the less-than table of the whole text with
+/// Y selected as a random substring of the text to std::vector<bool> with
+/// computeLessThanMatchTableToIterator (table-iterator) and to a packed
+/// bitvector with computeLessThanMatchTableToWords (table-words).
+void benchmarkTable() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			string Y = randomSubstring(X, m);
+			
+			vector<bool> B(X.size());
+			Timer timer;
+			srm::computeLessThanMatchTableToIterator(X.begin(), X.end(), Y.cbegin(), Y.cend(), B.begin());
+			double iterator_time = timer.getElapsedTime();
+			
+			vector<uint64_t> words(srm::packedWordCount(X.size()));
+			timer.reset();
+			srm::computeLessThanMatchTableToWords(X.begin(), X.end(), Y.cbegin(), Y.cend(), words.data());
+			double words_time = timer.getElapsedTime();
+			
+			for(size_t i = 0; i < X.size(); i += 4097) {
+				if(B[i] != srm::getPackedBit(words.data(), i)) fail("Tables disagree.");
+			}
+			
+			cout << "table-iterator " << text.first << " " << m << " ";
+			cout << 1e9 * iterator_time / X.size() << "\n";
+			cout << "table-words " << text.first << " " << m << " ";
+			cout << 1e9 * words_time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of reportRestrictedRangeMatches (report-restricted) and
+/// reportRestrictedRangeMatchesBlocked (report-restricted-blocked) in the whole
+/// text with Y selected as a random substring of the text and Y' = Y[0..1).
+void benchmarkReportRestricted() {
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : {64, 4096, 262144}) {
+			string Y = randomSubstring(X, m);
+			
+			size_t count = 0;
+			Timer timer;
+			srm::reportRestrictedRangeMatches(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Y.cbegin() + 1,
+				[&](size_t) { ++count; }
+			);
+			double time = timer.getElapsedTime();
+			
+			size_t blocked_count = 0;
+			timer.reset();
+			srm::reportRestrictedRangeMatchesBlocked(
+				X.begin(), X.end(), Y.cbegin(), Y.cend(), Y.cbegin() + 1,
+				[&](size_t) { ++blocked_count; }
+			);
+			double blocked_time = timer.getElapsedTime();
+			if(count != blocked_count) fail("Blocked and unblocked disagree.");
+			
+			cout << "report-restricted " << text.first << " " << m << " ";
+			cout << 1e9 * time / X.size() << "\n";
+			cout << "report-restricted-blocked " << text.first << " " << m << " ";
+			cout << 1e9 * blocked_time / X.size() << "\n";
+		}
+	}
+}
+
+/// Per-character time of reporting range matches in 4096 documents of 1024
+/// characters taken from the text, with Y and Z selected as random substrings of
+/// the text, using reportRangeMatches (report-docs) and a RangeReporter
+/// constructed once (report-docs-reporter).
+void benchmarkReportDocuments() {
+	const size_t document_count = 4096;
+	const size_t document_length = 1024;
+	for(const auto& text : texts()) {
+		const string& X = text.second;
+		for(size_t m : y_lengths) {
+			string Y, Z;
+			tie(Y, Z) = randomRange(X, m);
+			
+			size_t count = 0;
+			Timer timer;
+			for(size_t d = 0; d < document_count; ++d) {
+				SI doc = X.begin() + d * document_length;
+				srm::reportRangeMatches(
+					doc, doc + document_length,
+					Y.cbegin(), Y.cend(),
+					Z.cbegin(), Z.cend(),
+					[&](size_t) { ++count; }
+				);
+			}
+			double time = timer.getElapsedTime();
+			
+			size_t reporter_count = 0;
+			timer.reset();
+			auto reporter = srm::makeRangeReporter(Y.cbegin(), Y.cend(), Z.cbegin(), Z.cend());
+			for(size_t d = 0; d < document_count; ++d) {
+				SI doc = X.begin() + d * document_length;
+				reporter.report(doc, doc + document_length, [&](size_t) { ++reporter_count; });
+			}
+			double reporter_time = timer.getElapsedTime();
+			if(count != reporter_count) fail("Report and reporter disagree.");
+			
+			double chars = document_count * document_length;
+			cout << "report-docs " << text.first << " " << m << " ";
+			cout << 1e9 * time / chars << "\n";
+			cout << "report-docs-reporter " << text.first << " " << m << " ";
+			cout << 1e9 * reporter_time / chars << "\n";
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	map<string, function<void()>> benchmarks;
+	benchmarks["count"] = benchmarkCount;
+	benchmarks["count-k"] = benchmarkCountK;
+	benchmarks["count-idx32"] = benchmarkCountIdx32;
+	benchmarks["count-k-auto"] = benchmarkCountKAuto;
+	benchmarks["count-threads"] = benchmarkCountThreads;
+	benchmarks["batch"] = benchmarkBatch;
+	benchmarks["buckets"] = benchmarkBuckets;
+	benchmarks["construct"] = benchmarkConstruct;
+	benchmarks["stream"] = benchmarkStream;
+	benchmarks["pattern"] = benchmarkPatternIndex;
+	benchmarks["table"] = benchmarkTable;
+	benchmarks["table-range"] = benchmarkRangeTable;
+	benchmarks["table-parallel"] = benchmarkParallelTable;
+	benchmarks["table-file"] = benchmarkFileTable;
+	benchmarks["table-compressed"] = benchmarkCompressedTable;
+	benchmarks["report"] = benchmarkReport;
+	benchmarks["report-docs"] = benchmarkReportDocuments;
+	benchmarks["report-runs"] = benchmarkReportRuns;
+	benchmarks["report-output"] = benchmarkReportOutput;
+	benchmarks["report-sorted"] = benchmarkReportSorted;
+	benchmarks["report-first"] = benchmarkReportFirst;
+	benchmarks["report-restricted"] = benchmarkReportRestricted;
+	
+	vector<string> names;
+	for(int i = 1; i < argc; ++i) {
+		names.push_back(argv[i]);
+	}
+	if(names.empty()) {
+		for(const auto& benchmark : benchmarks) {
+			names.push_back(benchmark.first);
+		}
+	}
+	
+	for(const string& name : names) {
+		if(!benchmarks.count(name)) fail("Unknown benchmark ", name, ".");
+		benchmarks[name]();
+	}
+	
+	return 0;
+}
@@ -1,12 +1,24 @@
 #include "srm/table.hpp"
+#include "srm/bitvector.hpp"
 #include "srm/count.hpp"
 #include "srm/crochermore.hpp"
 #include "srm/report.hpp"
+#include "srm/stream.hpp"
+#include "srm/mmap.hpp"
+#include "srm/pattern.hpp"
 
 #include "testutil.hpp"
 
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <functional>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
 
 // Tests on randomly generated strings compared to naive solutions.
 
@@ -38,6 +50,446 @@ void randomTestLessThanMatch() {
 	if(count != cmpcount) fail();
 }
 
+/// Return random string of given length consisting mostly of repetitions of
+/// a short period, with characters between 'A' and 'A' + a.
+string randrepetitive(int length, int a) {
+	string period = randstring(rand(1, choice(3, 10)), 'A', 'A' + a);
+	string ret;
+	while((int)ret.size() < length) {
+		if(rand(0, choice(3, 20)) == 0) {
+			ret.append(randstring(1, 'A', 'A' + a));
+		} else {
+			ret.append(period);
+		}
+	}
+	return ret;
+}
+
+/// Return random range bound that is either a random string or a substring of
+/// X possibly followed by a random character.
+string randbound(const string& X, int a) {
+	if(X.empty() || choice(true, false)) {
+		return randstring(rand(0, choice(5, 15)), 'A', 'A' + a);
+	}
+	int i = rand(0, (int)X.size() - 1);
+	string B = X.substr(i, rand(1, (int)X.size() - i));
+	if(choice(true, false)) B.push_back('A' + rand(0, a));
+	return B;
+}
+
+void randomTestMatchLength() {
+	int a = rand(0, choice(1, 3, 255));
+	string X = randstring(rand(0, choice(10, 100, 300)), 'A', 'A' + a);
+	string Y = X.substr(rand(0, (int)X.size()));
+	Y += randstring(rand(0, choice(10, 100)), 'A', 'A' + a);
+	if(!Y.empty() && choice(true, false)) Y[rand(0, (int)Y.size() - 1)] = 'A' + rand(0, a);
+	int max = rand(0, (int)min(X.size(), Y.size()));
+	
+	int len = 0;
+	while(len < max && X[len] == Y[len]) ++len;
+	
+	if(srm::matchLength(X.data(), Y.data(), max) != len) fail();
+	if(srm::matchLength(X.begin(), Y.cbegin(), max) != len) fail();
+	
+	vector<char> Xv(X.begin(), X.end());
+	if(srm::matchLength(Xv.begin(), Y.begin(), (size_t)max) != (size_t)len) fail();
+	
+	deque<char> Xd(X.begin(), X.end());
+	if(srm::matchLength(Xd.begin(), Y.begin(), max) != len) fail();
+}
+
+void randomTestParallelCount() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	string Y = randbound(X, a);
+	string Z = randbound(X, a);
+	if(Y > Z) swap(Y, Z);
+	
+	size_t k = rand(3, 5);
+	unsigned thread_count = rand(1, 8);
+	
+	size_t count = 0;
+	size_t range_count = 0;
+	for(int i = 0; i < (int)X.size(); ++i) {
+		string Xi = X.substr(i);
+		if(Xi < Y) ++count;
+		if(Xi >= Y && Xi < Z) ++range_count;
+	}
+	
+	auto counter = srm::makeLessThanCounter(Y.begin(), Y.end(), k);
+	if(counter.count(X.begin(), X.end()) != count) fail();
+	if(counter.count(X.begin(), X.end(), thread_count) != count) fail();
+	
+	// Scans over short blocks that may pass the block ends by jumps within
+	// the limits of two chunks.
+	size_t bounds[3] = {0, rand((size_t)0, X.size()), X.size()};
+	size_t block_count = 0;
+	for(int chunk = 0; chunk < 2; ++chunk) {
+		size_t limit = bounds[chunk + 1];
+		auto state = counter.startScan(bounds[chunk]);
+		size_t pos = state.i;
+		while(pos < limit) {
+			pos = min(limit, pos + rand(1, 20));
+			counter.scan(X.begin(), X.end(), state, pos, limit);
+			if(state.i < pos || state.i > limit) fail();
+		}
+		if(state.i != limit) fail();
+		block_count += state.count;
+	}
+	if(block_count != count) fail();
+	
+	auto range_counter = srm::makeRangeCounter(Y.begin(), Y.end(), Z.begin(), Z.end(), k, k);
+	if(range_counter.count(X.begin(), X.end()) != range_count) fail();
+	if(range_counter.count(X.begin(), X.end(), thread_count) != range_count) fail();
+}
+
+void randomTestSpecializedCount() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	string Y = randbound(X, a);
+	string Z = randbound(X, a);
+	if(Y > Z) swap(Y, Z);
+	
+	size_t count = 0;
+	size_t range_count = 0;
+	for(int i = 0; i < (int)X.size(); ++i) {
+		string Xi = X.substr(i);
+		if(Xi < Y) ++count;
+		if(Xi >= Y && Xi < Z) ++range_count;
+	}
+	
+	if(srm::makeLessThanCounter<3>(Y.begin(), Y.end()).count(X.begin(), X.end()) != count) fail();
+	if(srm::makeLessThanCounter<4>(Y.begin(), Y.end()).count(X.begin(), X.end()) != count) fail();
+	if(srm::makeLessThanCounter<8>(Y.begin(), Y.end()).count(X.begin(), X.end()) != count) fail();
+	
+	auto counter = srm::makeLessThanCounter(Y.begin(), Y.end(), (uint32_t)rand(3, 5));
+	if(counter.count(X.begin(), X.end()) != count) fail();
+	
+	auto inline_counter = srm::makeInlineLessThanCounter(Y.begin(), Y.end(), (size_t)rand(3, 5));
+	if(inline_counter.count(X.begin(), X.end()) != count) fail();
+	if(inline_counter.getSpTable() != srm::makeLessThanCounter(Y.begin(), Y.end(), inline_counter.getK()).getSpTable()) fail();
+	
+	auto auto_counter = srm::makeLessThanCounter(Y.begin(), Y.end(), (size_t)0);
+	if(auto_counter.getK() < 3 || auto_counter.getK() > srm::maxAutoK) fail();
+	if(auto_counter.count(X.begin(), X.end()) != count) fail();
+	
+	size_t k = choice(0, 3, 5);
+	if(srm::countLessThan(X.begin(), X.end(), Y.begin(), Y.end(), k) != count) fail();
+	if(srm::countRangeMatches(X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), k) != range_count) fail();
+}
+
+void randomTestPatternIndex() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	int pattern_count = rand(0, 5);
+	
+	vector<string> Ys;
+	vector<char> blobs;
+	for(int j = 0; j < pattern_count; ++j) {
+		Ys.push_back(randbound(X, a));
+		srm::PatternIndex<char> index(Ys[j].begin(), Ys[j].end(), choice(0, 3, 4));
+		index.serialize(blobs);
+		if(blobs.size() % 8 != 0) fail();
+	}
+	
+	// The blobs must be aligned to 8 bytes.
+	vector<uint64_t> storage(blobs.size() / 8);
+	if(!blobs.empty()) memcpy(storage.data(), blobs.data(), blobs.size());
+	const char* data = (const char*)storage.data();
+	
+	auto indices = srm::loadPatternIndices<char>(data, blobs.size());
+	if((int)indices.size() != pattern_count) fail();
+	for(int j = 0; j < pattern_count; ++j) {
+		if(string(indices[j].begin(), indices[j].end()) != Ys[j]) fail();
+		
+		size_t count = 0;
+		for(int i = 0; i < (int)X.size(); ++i) {
+			if(X.substr(i) < Ys[j]) ++count;
+		}
+		if(indices[j].count(X.begin(), X.end()) != count) fail();
+	}
+	
+	if(pattern_count != 0) {
+		bool thrown = false;
+		try {
+			srm::PatternIndex<char>::load(data, rand((size_t)0, indices[0].serializedSize() - 1));
+		} catch(const runtime_error&) {
+			thrown = true;
+		}
+		if(!thrown) fail();
+		
+		// Corrupt an entry of the Sp or Sn table of the first blob, which
+		// start after the 64-byte header with table sizes at bytes 48 and 56.
+		// Each corruption breaks the rules b != 0, c <= b, b <= |Y| or the
+		// doubling of b, or the first element {1, 0} of Sn.
+		size_t* header = (size_t*)storage.data();
+		size_t* sp = header + 8;
+		size_t* sn = sp + header[6];
+		size_t sp_count = header[6] / 3;
+		size_t sn_count = header[7] / 2;
+		size_t m = Ys[0].size();
+		int type = rand(0, sp_count != 0 ? 6 : 3);
+		if(type == 0) {
+			sn[2 * rand((size_t)0, sn_count - 1)] = 0;
+		} else if(type == 1) {
+			sn[2 * rand((size_t)0, sn_count - 1) + 1] = max(m, (size_t)1) + 1;
+		} else if(type == 2) {
+			sn[2 * rand((size_t)0, sn_count - 1)] = max(m, (size_t)1) + 1;
+		} else if(type == 3) {
+			size_t t = rand((size_t)0, sn_count - 1);
+			if(t == 0) {
+				sn[1] = 1;
+			} else {
+				sn[2 * t] = sn[2 * t - 2];
+			}
+		} else if(type == 4) {
+			sp[3 * rand((size_t)0, sp_count - 1)] = rand(0, 1);
+		} else if(type == 5) {
+			size_t t = rand((size_t)0, sp_count - 1);
+			sp[3 * t + 2] = sp[3 * t] + 1;
+		} else {
+			size_t t = rand((size_t)0, sp_count - 1);
+			if(t == 0) {
+				sp[0] = m + 1;
+			} else {
+				sp[3 * t] = sp[3 * t - 3];
+			}
+		}
+		thrown = false;
+		try {
+			srm::PatternIndex<char>::load(data, blobs.size());
+		} catch(const runtime_error&) {
+			thrown = true;
+		}
+		if(!thrown) fail();
+	}
+}
+
+void randomTestBatchCount() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	
+	int q = rand(0, 5);
+	vector<string> bounds;
+	for(int j = 0; j < 2 * q; ++j) {
+		bounds.push_back(randbound(X, a));
+	}
+	
+	typedef srm::RangeCounter<string::iterator, string::iterator> Counter;
+	vector<Counter> counters;
+	vector<size_t> counts;
+	for(int j = 0; j < q; ++j) {
+		string& Y = bounds[2 * j];
+		string& Z = bounds[2 * j + 1];
+		if(Y > Z) swap(Y, Z);
+		counters.push_back(Counter(Y.begin(), Y.end(), Z.begin(), Z.end()));
+		counts.push_back(counters.back().count(X.begin(), X.end()));
+	}
+	
+	vector<size_t> cmpcounts = srm::countRangeMatchesBatch(
+		X.begin(), X.end(), counters, (unsigned)rand(0, 8)
+	);
+	if(counts != cmpcounts) fail();
+}
+
+void randomTestBuckets() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	
+	vector<string> bounds;
+	int b = rand(0, 6);
+	for(int j = 0; j < b; ++j) {
+		bounds.push_back(randbound(X, a));
+	}
+	sort(bounds.begin(), bounds.end());
+	bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+	b = bounds.size();
+	
+	vector<pair<string::iterator, string::iterator>> ranges;
+	for(string& B : bounds) {
+		ranges.push_back(make_pair(B.begin(), B.end()));
+	}
+	
+	vector<size_t> buckets(X.size());
+	vector<size_t> histogram(b + 1);
+	for(int i = 0; i < (int)X.size(); ++i) {
+		string Xi = X.substr(i);
+		buckets[i] = upper_bound(bounds.begin(), bounds.end(), Xi) - bounds.begin();
+		++histogram[buckets[i]];
+	}
+	
+	vector<size_t> cmphistogram = srm::makeBucketCounter(ranges)
+		.count(X.begin(), X.end(), (unsigned)rand(0, 8));
+	if(histogram != cmphistogram) fail();
+	
+	vector<size_t> cmpbuckets(X.size());
+	srm::computeBucketTableToIterator(
+		X.begin(), X.end(),
+		ranges,
+		cmpbuckets.begin()
+	);
+	if(buckets != cmpbuckets) fail();
+}
+
+void randomTestStreamingCount() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	string Y = randbound(X, a);
+	
+	size_t count = 0;
+	for(int i = 0; i < (int)X.size(); ++i) {
+		if(X.substr(i) < Y) ++count;
+	}
+	
+	auto counter = srm::makeStreamingLessThanCounter(Y.begin(), Y.end(), (size_t)rand(3, 5));
+	int max_chunk = choice(1, 10, 100);
+	size_t pos = 0;
+	while(pos < X.size()) {
+		size_t len = min(X.size() - pos, (size_t)rand(0, max_chunk));
+		counter.feed(X.data() + pos, len);
+		pos += len;
+	}
+	if(counter.finish() != count) fail();
+}
+
+void randomTestIncrementalCount() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+	string Y = randbound(X, a);
+	string Z = randbound(X, a);
+	if(Y > Z) swap(Y, Z);
+	
+	auto counter = srm::makeIncrementalRangeCounter(Y.begin(), Y.end(), Z.begin(), Z.end());
+	int max_chunk = choice(1, 10, 100);
+	size_t pos = 0;
+	while(true) {
+		size_t count = 0;
+		for(size_t i = 0; i < pos; ++i) {
+			string Xi = X.substr(i, pos - i);
+			if(Xi >= Y && Xi < Z) ++count;
+		}
+		if(counter.count() != count) fail();
+		
+		if(pos == X.size()) break;
+		size_t len = min(X.size() - pos, (size_t)rand(0, max_chunk));
+		counter.append(X.data() + pos, len);
+		pos += len;
+	}
+}
+
+void randomTestMappedFile() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(0, 10, 1000)), a);
+	string Y = randbound(X, a);
+	
+	char path[] = "/tmp/srm_randomtest_XXXXXX";
+	int fd = mkstemp(path);
+	if(fd == -1) fail("Creating temporary file failed.");
+	close(fd);
+	{
+		ofstream out(path, ios::binary);
+		out.write(X.data(), X.size());
+		if(!out.good()) fail("Writing temporary file failed.");
+	}
+	
+	srm::MappedFile file(path, choice(true, false));
+	remove(path);
+	
+	if(file.size() != X.size()) fail();
+	if(!equal(file.begin(), file.end(), X.begin())) fail();
+	
+	auto counter = srm::makeLessThanCounter(Y.begin(), Y.end());
+	if(counter.count(file.begin(), file.end()) != counter.count(X.begin(), X.end())) fail();
+}
+
+void randomTestMappedBitvector() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(0, 100, 5000)), a);
+	string Y = randbound(X, a);
+	string Z = randbound(X, a);
+	if(Y > Z) swap(Y, Z);
+	size_t word_count = srm::packedWordCount(X.size());
+	size_t release_words = rand(1, 100);
+	
+	char path[] = "/tmp/srm_randomtest_XXXXXX";
+	int fd = mkstemp(path);
+	if(fd == -1) fail("Creating temporary file failed.");
+	close(fd);
+	
+	vector<uint64_t> words(word_count);
+	srm::computeLessThanMatchTableToWords(X.begin(), X.end(), Y.begin(), Y.end(), words.data());
+	srm::computeLessThanMatchTableToFile(X.begin(), X.end(), Y.begin(), Y.end(), path, release_words);
+	{
+		srm::MappedBitvector bitvector = srm::MappedBitvector::load(path);
+		if(bitvector.size() != X.size()) fail();
+		if(!equal(words.begin(), words.end(), bitvector.words())) fail();
+	}
+	
+	srm::computeRangeMatchTableToWords(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), words.data()
+	);
+	srm::computeRangeMatchTableToFile(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), path, release_words
+	);
+	srm::MappedBitvector bitvector = srm::MappedBitvector::load(path);
+	if(bitvector.size() != X.size()) fail();
+	if(!equal(words.begin(), words.end(), bitvector.words())) fail();
+	size_t ones = 0;
+	for(size_t i = 0; i < X.size(); ++i) {
+		if(bitvector.rank(i) != ones) fail();
+		bool bit = srm::getPackedBit(words.data(), i);
+		if(bitvector[i] != bit) fail();
+		if(bit) {
+			if(bitvector.select(ones) != i) fail();
+			++ones;
+		}
+	}
+	if(bitvector.rank(X.size()) != ones || bitvector.count() != ones) fail();
+	
+	// Loading a file with an invalid total count of ones in the last rank
+	// sample fails.
+	{
+		uint64_t bad_count = X.size() + 1;
+		off_t offset = (off_t)(8 * (word_count + 2 + (word_count + 31) / 32));
+		int fd = open(path, O_WRONLY);
+		if(fd == -1 || pwrite(fd, &bad_count, 8, offset) != 8) fail("Writing temporary file failed.");
+		close(fd);
+		bool thrown = false;
+		try {
+			srm::MappedBitvector::load(path);
+		} catch(const runtime_error&) {
+			thrown = true;
+		}
+		if(!thrown) fail();
+	}
+	
+	// Loading a file with a wrong magic number fails.
+	{
+		char bad_magic = 'X';
+		int fd = open(path, O_WRONLY);
+		if(fd == -1 || pwrite(fd, &bad_magic, 1, rand(0, 7)) != 1) fail("Writing temporary file failed.");
+		close(fd);
+		bool thrown = false;
+		try {
+			srm::MappedBitvector::load(path);
+		} catch(const runtime_error&) {
+			thrown = true;
+		}
+		if(!thrown) fail();
+	}
+	
+	// Loading a truncated file fails.
+	if(truncate(path, rand(0, 8 * (int)word_count + 15)) == -1) fail("Truncating temporary file failed.");
+	bool thrown = false;
+	try {
+		srm::MappedBitvector::load(path);
+	} catch(const runtime_error&) {
+		thrown = true;
+	}
+	if(!thrown) fail();
+	remove(path);
+}
+
 void randomTestRangeMatch() {
 	int a = rand(0, choice(3, 8, 20));
 	string X = randstring(rand(0, choice(5, 15)), 'A', 'A' + a);
@@ -89,6 +541,272 @@ void randomTestRangeMatch() {
 	if(count != cmpcount) fail();
 }
 
+void randomTestRangeReporter() {
+	int a = rand(0, choice(1, 3, 20));
+	string base = randrepetitive(rand(0, choice(10, 100)), a);
+	string Y = randbound(base, a);
+	string Z = randbound(base, a);
+	if(Y > Z) swap(Y, Z);
+	
+	auto reporter = srm::makeRangeReporter(Y.begin(), Y.end(), Z.begin(), Z.end());
+	
+	int document_count = rand(1, 4);
+	for(int d = 0; d < document_count; ++d) {
+		string X = randrepetitive(rand(0, choice(10, 100, 300)), a);
+		
+		vector<int> matches;
+		for(int i = 0; i < (int)X.size(); ++i) {
+			string Xi = X.substr(i);
+			if(Xi >= Y && Xi < Z) matches.push_back(i);
+		}
+		
+		vector<int> cmpmatches;
+		reporter.report(X.begin(), X.end(), [&](int i) { cmpmatches.push_back(i); });
+		sort(cmpmatches.begin(), cmpmatches.end());
+		
+		if(matches != cmpmatches) fail();
+		
+		// Output functions callable with extra arguments, such as the results of
+		// std::bind, must still get every match by itself.
+		struct MatchCollector {
+			vector<int>& matches;
+			void add(int i) {
+				matches.push_back(i);
+			}
+		};
+		MatchCollector collector{cmpmatches};
+		auto bind_output = std::bind(&MatchCollector::add, &collector, std::placeholders::_1);
+		
+		cmpmatches.clear();
+		reporter.report(X.begin(), X.end(), bind_output);
+		sort(cmpmatches.begin(), cmpmatches.end());
+		if(matches != cmpmatches) fail();
+		
+		cmpmatches.clear();
+		srm::reportRangeMatches(X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), bind_output);
+		sort(cmpmatches.begin(), cmpmatches.end());
+		if(matches != cmpmatches) fail();
+		
+		cmpmatches.clear();
+		reporter.reportSorted(X.begin(), X.end(), [&](int i) { cmpmatches.push_back(i); });
+		if(matches != cmpmatches) fail();
+		
+		cmpmatches.clear();
+		auto cursor = srm::makeRangeMatchCursor(reporter, X.begin(), X.end());
+		size_t match;
+		while(cursor.next(match)) {
+			cmpmatches.push_back((int)match);
+		}
+		if(cursor.next(match)) fail();
+		if(matches != cmpmatches) fail();
+		
+		size_t limit = rand(0, (int)matches.size() + 2);
+		cmpmatches.clear();
+		size_t found = reporter.reportFirst(X.begin(), X.end(), limit, [&](int i) { cmpmatches.push_back(i); });
+		if(found != min(limit, matches.size())) fail();
+		if(!equal(cmpmatches.begin(), cmpmatches.end(), matches.begin())) fail();
+		if(cmpmatches.size() != found) fail();
+		
+		if(reporter.exists(X.begin(), X.end()) != !matches.empty()) fail();
+	}
+}
+
+void randomTestMatchSpans() {
+	int a = rand(0, choice(1, 3, 20));
+	string base = randrepetitive(rand(0, choice(10, 100)), a);
+	string Y = randbound(base, a);
+	string Z = randbound(base, a);
+	if(Y > Z) swap(Y, Z);
+	string X = randrepetitive(rand(0, choice(10, 100, 3000)), a);
+	
+	vector<size_t> matches;
+	srm::reportRangeMatches(
+		X.begin(), X.end(),
+		Y.begin(), Y.end(),
+		Z.begin(), Z.end(),
+		[&](size_t i) {
+			matches.push_back(i);
+		}
+	);
+	sort(matches.begin(), matches.end());
+	
+	// Spans written to arrays of both widths.
+	vector<uint32_t> array32(X.size() + 1);
+	size_t size32 = 0;
+	srm::reportRangeMatchSpans(
+		X.begin(), X.end(),
+		Y.begin(), Y.end(),
+		Z.begin(), Z.end(),
+		srm::ArraySink<uint32_t>{array32.data(), size32}
+	);
+	array32.resize(size32);
+	sort(array32.begin(), array32.end());
+	if(array32.size() != matches.size()) fail();
+	if(!equal(matches.begin(), matches.end(), array32.begin())) fail();
+	
+	auto reporter = srm::makeRangeReporter(Y.begin(), Y.end(), Z.begin(), Z.end());
+	vector<uint64_t> array64(X.size() + 1);
+	size_t size64 = 0;
+	reporter.reportSpans(X.begin(), X.end(), srm::ArraySink<uint64_t>{array64.data(), size64});
+	array64.resize(size64);
+	sort(array64.begin(), array64.end());
+	if(array64.size() != matches.size()) fail();
+	if(!equal(matches.begin(), matches.end(), array64.begin())) fail();
+	
+	// A small buffer is flushed many times, also in the middle of runs.
+	vector<size_t> cmpmatches;
+	size_t span_count = 0;
+	auto consumer = [&](const size_t* begin, const size_t* end) {
+		if(begin == end || end - begin > 3) fail();
+		cmpmatches.insert(cmpmatches.end(), begin, end);
+		++span_count;
+	};
+	srm::SpanOutput<decltype(consumer), size_t, 3> output(consumer);
+	reporter.report<string::iterator, decltype(output)&>(X.begin(), X.end(), output);
+	output.flush();
+	sort(cmpmatches.begin(), cmpmatches.end());
+	if(matches != cmpmatches) fail();
+	if(span_count != (matches.size() + 2) / 3) fail();
+}
+
+void randomTestCopyPackedBits() {
+	size_t n = rand(1, choice(10, 100, 1000));
+	vector<uint64_t> words(srm::packedWordCount(n));
+	for(uint64_t& word : words) {
+		word = rand((uint64_t)0, ~(uint64_t)0);
+	}
+	size_t src = rand(0, (int)n - 1);
+	size_t dst = rand((int)src, (int)n);
+	size_t s = rand(0, (int)min(dst - src, n - dst));
+	
+	vector<bool> expected(n);
+	for(size_t i = 0; i < n; ++i) {
+		expected[i] = srm::getPackedBit(words.data(), i);
+	}
+	copy(expected.begin() + src, expected.begin() + src + s, expected.begin() + dst);
+	
+	srm::copyPackedBits(words.data(), dst, src, s);
+	for(size_t i = 0; i < n; ++i) {
+		if(srm::getPackedBit(words.data(), i) != expected[i]) fail();
+	}
+}
+
+void randomTestPackedTable() {
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(0, choice(10, 200, 2000, 20000)), a);
+	string Y = randbound(X.substr(0, 2000), a);
+	string Z = randbound(X.substr(0, 2000), a);
+	if(Y > Z) swap(Y, Z);
+	size_t word_count = srm::packedWordCount(X.size());
+	
+	// The words are initially filled with ones to check that all the bits
+	// are written, including the ones after the table in the last word.
+	vector<bool> B(X.size());
+	vector<uint64_t> words(word_count, ~(uint64_t)0);
+	srm::computeLessThanMatchTableToIterator(X.begin(), X.end(), Y.begin(), Y.end(), B.begin());
+	srm::computeLessThanMatchTableToWords(X.begin(), X.end(), Y.begin(), Y.end(), words.data());
+	for(size_t i = 0; i < 64 * word_count; ++i) {
+		if(srm::getPackedBit(words.data(), i) != (i < X.size() && B[i])) fail();
+	}
+	
+	// Parallel computation with chunks restarted from their starts, writing
+	// to words at a random offset from a cache line boundary.
+	unsigned thread_count = rand(2, 4);
+	vector<uint64_t> parallel_storage(word_count + 7, ~(uint64_t)0);
+	uint64_t* parallel_words = parallel_storage.data() + rand(0, 7);
+	srm::computeLessThanMatchTableToWords(
+		X.begin(), X.end(), Y.begin(), Y.end(), parallel_words, thread_count
+	);
+	if(!equal(words.begin(), words.end(), parallel_words)) fail();
+	
+	words.assign(word_count, ~(uint64_t)0);
+	srm::computeRangeMatchTableToIterator(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), B.begin()
+	);
+	srm::computeRangeMatchTableToWords(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), words.data()
+	);
+	for(size_t i = 0; i < 64 * word_count; ++i) {
+		if(srm::getPackedBit(words.data(), i) != (i < X.size() && B[i])) fail();
+	}
+	
+	parallel_storage.assign(word_count + 7, ~(uint64_t)0);
+	srm::computeRangeMatchTableToWords(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(),
+		parallel_words, thread_count
+	);
+	if(!equal(words.begin(), words.end(), parallel_words)) fail();
+	
+	srm::CompressedBitvector compressed = srm::computeRangeMatchTableCompressed(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end()
+	);
+	if(compressed.size() != X.size()) fail();
+	for(size_t i = 0; i < X.size(); ++i) {
+		if(compressed[i] != (bool)B[i]) fail();
+	}
+}
+
+void randomTestCompressedBitvector(bool long_bitvector) {
+	// Words consisting of runs of zeros, ones, random words and repeats of
+	// earlier words to produce both repeated and distinct blocks. The long
+	// bitvectors pass the checks of the build for switching to plain storage.
+	size_t n = long_bitvector ? rand(500000, 2000000) : rand(0, choice(100, 2000, 50000));
+	size_t word_count = srm::packedWordCount(n);
+	vector<uint64_t> words;
+	int prob = rand(1, choice(2, 20, 1000));
+	while(words.size() < word_count) {
+		int type = rand(0, 3);
+		size_t len = rand(1, choice(1, 8, 100));
+		for(size_t t = 0; t < len && words.size() < word_count; ++t) {
+			uint64_t word;
+			if(type == 0) {
+				word = 0;
+			} else if(type == 1) {
+				word = ~(uint64_t)0;
+			} else if(type == 2 || words.empty() || rand(0, prob) == 0) {
+				word = rand((uint64_t)0, ~(uint64_t)0);
+			} else {
+				word = words[words.size() - 1 - rand((size_t)0, min(words.size() - 1, (size_t)64))];
+			}
+			words.push_back(word);
+		}
+	}
+	if(n % 64 != 0) words.back() &= srm::lowBitMask(n % 64);
+	
+	size_t w = 0;
+	srm::CompressedBitvector compressed = srm::CompressedBitvector::build(n, [&]() {
+		return words[w++];
+	});
+	if(w != word_count) fail();
+	if(compressed.size() != n) fail();
+	
+	// The size is at most that of the plain blocks and the samples.
+	size_t block_count = (word_count + 7) / 8;
+	if(compressed.byteSize() > 64 * block_count + 8 * (block_count / 64 + 2)) fail();
+	if(compressed.isPlain() == (compressed.dictionarySize() != 0)) fail();
+	
+	vector<size_t> one_positions;
+	for(size_t i = 0; i < n; ++i) {
+		if(srm::getPackedBit(words.data(), i)) one_positions.push_back(i);
+	}
+	if(compressed.count() != one_positions.size()) fail();
+	
+	// Check all the positions of short bitvectors and random positions of
+	// long ones.
+	size_t query_count = min(n + 1, (size_t)200000);
+	for(size_t q = 0; q < query_count; ++q) {
+		size_t i = query_count == n + 1 ? q : rand((size_t)0, n);
+		size_t rank = lower_bound(one_positions.begin(), one_positions.end(), i) - one_positions.begin();
+		if(compressed.rank(i) != rank) fail();
+		if(i < n && compressed[i] != srm::getPackedBit(words.data(), i)) fail();
+	}
+	query_count = min(one_positions.size(), (size_t)200000);
+	for(size_t q = 0; q < query_count; ++q) {
+		size_t k = query_count == one_positions.size() ? q : rand((size_t)0, one_positions.size() - 1);
+		if(compressed.select(k) != one_positions[k]) fail();
+	}
+}
+
 void randomTestStringPeriod() {
 	int a = rand(0, choice(3, 8, 20));
 	string X = randstring(rand(0, choice(5, 15, 30)), 'A', 'A' + a);
@@ -149,6 +867,20 @@ void randomTestExactStringMatching() {
 	if(!equal(matches.begin(), matches.end(), cmpmatches.begin())) fail();
 }
 
+// Output function accepting runs of matches.
+struct RunOutput {
+	typedef void RunOutputTag;
+	
+	vector<int>& matches;
+	void operator()(int i) {
+		matches.push_back(i);
+	}
+	void operator()(int start, int step, int count) {
+		if(count <= 0 || step <= 0) fail();
+		for(int t = 0; t < count; ++t) matches.push_back(start + t * step);
+	}
+};
+
 void randomTestRestrictedRangeMatches() {
 	bool less_than = choice(true, false);
 	int a = rand(0, choice(3, 8, 20));
@@ -188,6 +920,90 @@ void randomTestRestrictedRangeMatches() {
 	
 	if(matches.size() != cmpmatches.size()) fail();
 	if(!equal(matches.begin(), matches.end(), cmpmatches.begin())) fail();
+	
+	vector<int> run_matches;
+	srm::reportRestrictedRangeMatches<string::iterator, string::iterator, RunOutput, int>(
+		X.begin(), X.end(),
+		Y.begin(), Y.end(), Y.begin() + r,
+		RunOutput{run_matches},
+		less_than
+	);
+	sort(run_matches.begin(), run_matches.end());
+	if(matches != run_matches) fail();
+	
+	vector<int> blocked_matches;
+	srm::reportRestrictedRangeMatchesBlocked(
+		X.begin(), X.end(),
+		Y.begin(), Y.end(), Y.begin() + r,
+		[&](int i) {
+			blocked_matches.push_back(i);
+		},
+		less_than
+	);
+	
+	sort(blocked_matches.begin(), blocked_matches.end());
+	
+	if(matches != blocked_matches) fail();
+}
+
+void randomTestLongBlockedReport() {
+	// X spans several scan blocks, so that the scans are carried over block
+	// boundaries. The results are compared to the unblocked algorithms.
+	int a = rand(0, choice(1, 3, 20));
+	string X = randrepetitive(rand(1, 3) * (int)srm::scanBlockSize() + rand(-100, 100), a);
+	int y_length = choice(200, 100000);
+	string Y = randbound(X.substr(0, y_length), a);
+	string Z = randbound(X.substr(0, y_length), a);
+	if(Y > Z) swap(Y, Z);
+	bool less_than = choice(true, false);
+	int r = rand(0, (int)Y.size());
+	
+	vector<int> matches;
+	auto output = [&](int i) { matches.push_back(i); };
+	srm::reportRestrictedRangeMatches(
+		X.begin(), X.end(), Y.begin(), Y.end(), Y.begin() + r, output, less_than
+	);
+	sort(matches.begin(), matches.end());
+	vector<int> expected = matches;
+	
+	matches.clear();
+	srm::reportRestrictedRangeMatchesBlocked(
+		X.begin(), X.end(), Y.begin(), Y.end(), Y.begin() + r, output, less_than
+	);
+	sort(matches.begin(), matches.end());
+	if(matches != expected) fail();
+	
+	matches.clear();
+	srm::reportRangeMatches(X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(), output);
+	sort(matches.begin(), matches.end());
+	expected = matches;
+	
+	matches.clear();
+	auto reporter = srm::makeRangeReporter(Y.begin(), Y.end(), Z.begin(), Z.end());
+	reporter.report(X.begin(), X.end(), output);
+	sort(matches.begin(), matches.end());
+	if(matches != expected) fail();
+	
+	matches.clear();
+	reporter.reportSorted(X.begin(), X.end(), output);
+	if(matches != expected) fail();
+	
+	matches.clear();
+	size_t limit = rand(0, 2 * (int)expected.size() + 2);
+	size_t found = reporter.reportFirst(X.begin(), X.end(), limit, output);
+	if(found != min(limit, expected.size()) || matches.size() != found) fail();
+	if(!equal(matches.begin(), matches.end(), expected.begin())) fail();
+	if(reporter.exists(X.begin(), X.end()) != !expected.empty()) fail();
+	
+	size_t count = srm::makeRangeCounter(Y.begin(), Y.end(), Z.begin(), Z.end()).count(X.begin(), X.end());
+	if(count != expected.size()) fail();
+	
+	size_t run_count = 0;
+	srm::reportRangeMatches(
+		X.begin(), X.end(), Y.begin(), Y.end(), Z.begin(), Z.end(),
+		srm::MatchCountOutput<>{run_count}
+	);
+	if(run_count != expected.size()) fail();
 }
 
 int main() {
@@ -196,10 +1012,27 @@ int main() {
 	int64_t report_interval = 10000;
 	while(true) {
 		randomTestLessThanMatch();
+		randomTestMatchLength();
+		randomTestParallelCount();
+		randomTestSpecializedCount();
+		randomTestPatternIndex();
+		randomTestBatchCount();
+		randomTestBuckets();
+		randomTestStreamingCount();
+		randomTestIncrementalCount();
+		randomTestMappedFile();
+		randomTestMappedBitvector();
 		randomTestRangeMatch();
+		randomTestCopyPackedBits();
+		randomTestPackedTable();
+		randomTestCompressedBitvector(false);
+		randomTestRangeReporter();
+		randomTestMatchSpans();
 		randomTestStringPeriod();
 		randomTestExactStringMatching();
 		randomTestRestrictedRangeMatches();
+		if(count % 1000 == 0) randomTestLongBlockedReport();
+		if(count % 100 == 0) randomTestCompressedBitvector(true);
 		++count;
 		if(count % report_interval == 0) cout << "Run " << count << " cycles.\n";
 	}
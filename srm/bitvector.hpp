@@ -0,0 +1,464 @@
+#pragma once
+
+#include "table.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <unordered_set>
+#include <vector>
+
+// Packed bitvector output for the lookup table algorithms.
+
+namespace srm {
+
+/// Output target of computeLessThanMatchTable writing a packed bitvector to
+/// words. The output is written in increasing order of position, so set
+/// collects the bits of the current word in a register and stores the word
+/// when it is full. Copies are done in memory by copyPackedBits, after storing
+/// the current word. The bits of the last word after the output are cleared.
+template <typename Idx = std::size_t>
+class PackedBitWriter {
+public:
+	explicit PackedBitWriter(std::uint64_t* words)
+		: words(words),
+		  pos(0),
+		  word(0)
+	{ }
+	
+	/// Set the bit at the current position i to val.
+	void set(Idx i, bool val) {
+		assert((std::size_t)i == pos);
+		(void)i;
+		word |= (std::uint64_t)val << (pos % 64);
+		++pos;
+		if(pos % 64 == 0) {
+			words[pos / 64 - 1] = word;
+			word = 0;
+		}
+	}
+	
+	/// Copy the bits [j, j + s) to the current position i, where j + s <= i.
+	void copy(Idx i, Idx j, Idx s) {
+		assert((std::size_t)i == pos);
+		(void)i;
+		if(s == 0) return;
+		if(pos % 64 != 0) words[pos / 64] = word;
+		copyPackedBits(words, pos, (std::size_t)j, (std::size_t)s);
+		pos += (std::size_t)s;
+		word = pos % 64 != 0 ? words[pos / 64] & lowBitMask(pos % 64) : 0;
+	}
+	
+	/// Store the last partial word. Must be called after the output is
+	/// complete.
+	void flush() {
+		if(pos % 64 != 0) words[pos / 64] = word;
+	}
+	
+private:
+	std::uint64_t* words;
+	std::size_t pos; ///< Position of the next bit to write.
+	std::uint64_t word; ///< Bits of word pos / 64 before pos.
+};
+
+/// Call generate_chunk(begin, end) for chunks [begin, end) of word range
+/// [0, word_count) of packed bitvector words in thread_count threads. The
+/// chunk boundaries are at the 64-byte cache line boundaries of words (the
+/// first chunk also contains the words before the first boundary), so that
+/// the threads do not write to the same cache lines. There are several
+/// chunks per thread to balance the load.
+template <typename F>
+void generateWordsInParallel(
+	const std::uint64_t* words,
+	std::size_t word_count,
+	unsigned thread_count,
+	F generate_chunk
+) {
+	// Number of words before the first cache line boundary.
+	std::size_t offset = (std::size_t)((std::uintptr_t)words % 64);
+	std::size_t lead = std::min(word_count, (64 - offset) % 64 / 8);
+	std::size_t line_count = (word_count - lead + 7) / 8;
+	std::size_t chunk_count = std::max((std::size_t)1, std::min(
+		line_count, thread_count <= 1 ? (std::size_t)1 : (std::size_t)4 * thread_count
+	));
+	auto split = [&](std::size_t t) {
+		if(t == 0) return (std::size_t)0;
+		if(t == chunk_count) return word_count;
+		return std::min(word_count, lead + 8 * splitPoint(line_count, chunk_count, t));
+	};
+	runTasksInParallel(chunk_count, thread_count, [&](std::size_t t) {
+		generate_chunk(split(t), split(t + 1));
+	});
+}
+
+/// Compute the same boolean vector as computeLessThanMatchTable to packed
+/// bitvector words, which must have room for packedWordCount(n) words where n
+/// is the length of string X. The bits of the last word after the table are
+/// cleared. See computeLessThanMatchTable for description of other parameters.
+///
+/// If thread_count is greater than one, X is split into chunks of whole cache
+/// lines of the output, see generateWordsInParallel, and the table of each
+/// chunk is computed in parallel by restarting a LessThanMatchTableGenerator
+/// at its start, using O(|Y|) bits of extra space. Otherwise uses constant
+/// extra space.
+template <typename XI, typename YI, typename Idx = std::size_t>
+void computeLessThanMatchTableToWords(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	std::uint64_t* words,
+	unsigned thread_count = 1
+) {
+	if(thread_count > 1) {
+		LessThanMatchTableGenerator<XI, YI, Idx> gen(x_begin, x_end, y_begin, y_end);
+		generateWordsInParallel(
+			words, packedWordCount((std::size_t)(x_end - x_begin)), thread_count,
+			[&](std::size_t begin, std::size_t end) {
+				LessThanMatchTableGenerator<XI, YI, Idx> chunk_gen = gen;
+				chunk_gen.restart((Idx)(64 * begin));
+				for(std::size_t w = begin; w < end; ++w) {
+					words[w] = chunk_gen.next();
+				}
+			}
+		);
+		return;
+	}
+	
+	PackedBitWriter<Idx> writer(words);
+	auto set_output = [&writer](Idx i, bool val) {
+		writer.set(i, val);
+	};
+	auto copy_output = [&writer](Idx i, Idx j, Idx s) {
+		writer.copy(i, j, s);
+	};
+	computeLessThanMatchTable<XI, YI, decltype(set_output), decltype(copy_output), Idx>(
+		x_begin, x_end,
+		y_begin, y_end,
+		set_output, copy_output
+	);
+	writer.flush();
+}
+
+/// Compute the same boolean vector as computeRangeMatchTableToIterator to
+/// packed bitvector words, which must have room for packedWordCount(n) words
+/// where n is the length of string X. The words generated for Y and Z are
+/// combined directly to the output, without temporary tables, using
+/// O(|Y| + |Z|) bits of extra space (see computeRangeMatchTableToIterator for
+/// why not constant). The chunks of the output are computed in
+/// parallel in thread_count threads as in computeLessThanMatchTableToWords.
+template <typename XI, typename YI, typename ZI, typename Idx = std::size_t>
+void computeRangeMatchTableToWords(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end,
+	std::uint64_t* words,
+	unsigned thread_count = 1
+) {
+	LessThanMatchTableGenerator<XI, YI, Idx> y_gen(x_begin, x_end, y_begin, y_end);
+	LessThanMatchTableGenerator<XI, ZI, Idx> z_gen(x_begin, x_end, z_begin, z_end);
+	
+	generateWordsInParallel(
+		words, packedWordCount((std::size_t)(x_end - x_begin)), thread_count,
+		[&](std::size_t begin, std::size_t end) {
+			LessThanMatchTableGenerator<XI, YI, Idx> chunk_y_gen = y_gen;
+			LessThanMatchTableGenerator<XI, ZI, Idx> chunk_z_gen = z_gen;
+			chunk_y_gen.restart((Idx)(64 * begin));
+			chunk_z_gen.restart((Idx)(64 * begin));
+			for(std::size_t w = begin; w < end; ++w) {
+				words[w] = chunk_z_gen.next() & ~chunk_y_gen.next();
+			}
+		}
+	);
+}
+
+/// Compressed bitvector for bitvectors with many repeated blocks, such as the
+/// match tables of highly repetitive texts. The bitvector is split into blocks
+/// of 512 bits, and each distinct block is stored only once in a dictionary;
+/// for each block, only its index in the dictionary is stored, using as few
+/// bits as the dictionary size allows. Long runs of zeros or ones thus take a
+/// few bits per block. If the dictionary would not be smaller than the plain
+/// blocks, as for non-repetitive bitvectors, the blocks are stored as plain
+/// packed words instead. The number of ones before every 64th block is
+/// sampled, so that access, rank and select work without decompressing the
+/// bitvector.
+class CompressedBitvector {
+public:
+	static const std::size_t BlockWords = 8;
+	static const std::size_t BlockBits = 64 * BlockWords;
+	static const std::size_t SampleBlocks = 64;
+	
+	/// Number of blocks after which the build first checks whether the
+	/// dictionary pays off. The check is repeated whenever the number of
+	/// blocks doubles.
+	static const std::size_t CheckBlocks = 1024;
+	
+	/// Build a compressed bitvector of n bits from the packed bitvector words
+	/// returned by consecutive calls of next_word(), in increasing order. The
+	/// bits of the last word after the bitvector must be cleared. Uses memory
+	/// proportional to the size of the result and n / 128 bytes for the block
+	/// indices before packing them. If the dictionary does not pay off at a
+	/// check, the build switches to plain storage, so the memory use is also
+	/// bounded by about the size of the plain bitvector.
+	template <typename F>
+	static CompressedBitvector build(std::size_t n, F next_word) {
+		CompressedBitvector ret;
+		ret.n = n;
+		ret.ones = 0;
+		ret.plain = false;
+		ret.index_bits = 0;
+		
+		// The dictionary is a hash set of the indices of the distinct blocks,
+		// hashed and compared by the words of the blocks in dict_words, so
+		// that the blocks are not stored twice.
+		const std::vector<std::uint64_t>& dict_words = ret.dict_words;
+		auto block_hash = [&dict_words](std::uint32_t index) {
+			const std::uint64_t* block = dict_words.data() + BlockWords * index;
+			std::uint64_t h = 0;
+			for(std::size_t t = 0; t < BlockWords; ++t) {
+				h = (h ^ block[t]) * (std::uint64_t)0x9E3779B97F4A7C15;
+				h ^= h >> 29;
+			}
+			return (std::size_t)h;
+		};
+		auto block_equal = [&dict_words](std::uint32_t a, std::uint32_t b) {
+			return std::equal(
+				dict_words.data() + BlockWords * a,
+				dict_words.data() + BlockWords * (a + 1),
+				dict_words.data() + BlockWords * b
+			);
+		};
+		std::unordered_set<std::uint32_t, decltype(block_hash), decltype(block_equal)>
+			dictionary(16, block_hash, block_equal);
+		std::vector<std::uint32_t> blocks;
+		
+		std::size_t word_count = packedWordCount(n);
+		for(std::size_t w = 0; w < word_count; w += BlockWords) {
+			std::size_t b = w / BlockWords;
+			if(b % SampleBlocks == 0) ret.samples.push_back(ret.ones);
+			
+			// Append the block to the words, which either adds it to the
+			// dictionary or the plain storage, or is undone if the block is
+			// already in the dictionary.
+			std::size_t block_ones = 0;
+			std::size_t block_end = std::min(word_count - w, (std::size_t)BlockWords);
+			for(std::size_t t = 0; t < BlockWords; ++t) {
+				std::uint64_t word = t < block_end ? next_word() : 0;
+				ret.dict_words.push_back(word);
+				block_ones += popCount(word);
+			}
+			ret.ones += block_ones;
+			if(ret.plain) continue;
+			
+			auto inserted = dictionary.insert((std::uint32_t)ret.dict_ones.size());
+			if(inserted.second) {
+				ret.dict_ones.push_back((std::uint16_t)block_ones);
+			} else {
+				ret.dict_words.resize(ret.dict_words.size() - BlockWords);
+			}
+			blocks.push_back(*inserted.first);
+			
+			std::size_t block_count = b + 1;
+			if(
+				block_count >= CheckBlocks &&
+				(block_count & (block_count - 1)) == 0 &&
+				!dictionaryPaysOff(ret.dict_ones.size(), block_count)
+			) {
+				dictionary.clear();
+				ret.switchToPlain(blocks);
+			}
+		}
+		if((word_count + BlockWords - 1) / BlockWords % SampleBlocks == 0) {
+			ret.samples.push_back(ret.ones);
+		}
+		
+		if(!ret.plain && !dictionaryPaysOff(ret.dict_ones.size(), blocks.size())) {
+			ret.switchToPlain(blocks);
+		}
+		if(!ret.plain) {
+			ret.index_bits = indexBits(ret.dict_ones.size());
+			ret.index_words.resize(packedWordCount(blocks.size() * ret.index_bits));
+			for(std::size_t b = 0; b < blocks.size(); ++b) {
+				writePackedBits(ret.index_words.data(), b * ret.index_bits, ret.index_bits, blocks[b]);
+			}
+		}
+		
+		return ret;
+	}
+	
+	/// Number of bits.
+	std::size_t size() const {
+		return n;
+	}
+	
+	/// Number of ones.
+	std::size_t count() const {
+		return ones;
+	}
+	
+	/// Return true if the blocks are stored as plain packed words instead of
+	/// the dictionary.
+	bool isPlain() const {
+		return plain;
+	}
+	
+	/// Number of distinct blocks stored in the dictionary, or 0 if the blocks
+	/// are stored as plain packed words.
+	std::size_t dictionarySize() const {
+		return dict_ones.size();
+	}
+	
+	/// Number of bytes used by the data of the compressed bitvector.
+	std::size_t byteSize() const {
+		return sizeof(std::uint64_t) * (dict_words.size() + index_words.size() + samples.size())
+			+ sizeof(std::uint16_t) * dict_ones.size();
+	}
+	
+	bool operator[](std::size_t i) const {
+		assert(i < n);
+		return getPackedBit(blockWords(i / BlockBits), i % BlockBits);
+	}
+	
+	/// Return the number of ones in positions [0, i), where i <= size().
+	std::size_t rank(std::size_t i) const {
+		assert(i <= n);
+		std::size_t b = i / BlockBits;
+		std::size_t ret = samples[b / SampleBlocks];
+		for(std::size_t c = b - b % SampleBlocks; c < b; ++c) {
+			ret += blockOnes(c);
+		}
+		if(i % BlockBits != 0) {
+			const std::uint64_t* words = blockWords(b);
+			std::size_t w = (i % BlockBits) / 64;
+			for(std::size_t t = 0; t < w; ++t) {
+				ret += popCount(words[t]);
+			}
+			ret += popCount(words[w] & lowBitMask(i % 64));
+		}
+		return ret;
+	}
+	
+	/// Return the position of the one with rank k, i.e. the (k + 1)th one,
+	/// where k < count().
+	std::size_t select(std::size_t k) const {
+		assert(k < ones);
+		std::size_t s = std::upper_bound(samples.begin(), samples.end(), k) - samples.begin() - 1;
+		k -= samples[s];
+		std::size_t b = s * SampleBlocks;
+		while(true) {
+			std::size_t block_ones = blockOnes(b);
+			if(k < block_ones) break;
+			k -= block_ones;
+			++b;
+		}
+		const std::uint64_t* words = blockWords(b);
+		std::size_t w = 0;
+		while(true) {
+			std::size_t word_ones = popCount(words[w]);
+			if(k < word_ones) break;
+			k -= word_ones;
+			++w;
+		}
+		return b * BlockBits + 64 * w + selectInWord(words[w], (int)k);
+	}
+	
+private:
+	CompressedBitvector() { }
+	
+	/// Return the number of bits needed for the indices of a dictionary of
+	/// dict_count blocks.
+	static std::size_t indexBits(std::size_t dict_count) {
+		std::size_t ret = 1;
+		while(((std::size_t)1 << ret) < dict_count) ++ret;
+		return ret;
+	}
+	
+	/// Return true if a dictionary of dict_count distinct blocks with the
+	/// indices of block_count blocks is smaller than the plain blocks.
+	static bool dictionaryPaysOff(std::size_t dict_count, std::size_t block_count) {
+		std::size_t dict_bytes = (8 * BlockWords + sizeof(std::uint16_t)) * dict_count
+			+ (block_count * indexBits(dict_count) + 7) / 8;
+		return dict_bytes < 8 * BlockWords * block_count;
+	}
+	
+	/// Replace the dictionary by plain storage of the blocks with given
+	/// dictionary indices, after which the remaining blocks are appended to
+	/// dict_words directly.
+	void switchToPlain(std::vector<std::uint32_t>& blocks) {
+		std::vector<std::uint64_t> words;
+		words.reserve(dict_words.capacity());
+		for(std::uint32_t index : blocks) {
+			words.insert(
+				words.end(),
+				dict_words.begin() + BlockWords * index,
+				dict_words.begin() + BlockWords * (index + 1)
+			);
+		}
+		dict_words.swap(words);
+		std::vector<std::uint16_t>().swap(dict_ones);
+		std::vector<std::uint32_t>().swap(blocks);
+		plain = true;
+	}
+	
+	std::size_t blockIndex(std::size_t b) const {
+		if(plain) return b;
+		return (std::size_t)readPackedBits(index_words.data(), b * index_bits, index_bits);
+	}
+	const std::uint64_t* blockWords(std::size_t b) const {
+		return dict_words.data() + BlockWords * blockIndex(b);
+	}
+	std::size_t blockOnes(std::size_t b) const {
+		if(!plain) return dict_ones[blockIndex(b)];
+		const std::uint64_t* words = blockWords(b);
+		std::size_t ret = 0;
+		for(std::size_t t = 0; t < BlockWords; ++t) {
+			ret += popCount(words[t]);
+		}
+		return ret;
+	}
+	
+	std::size_t n;
+	std::size_t ones;
+	bool plain; ///< True if the blocks are stored in order in dict_words.
+	std::vector<std::uint64_t> dict_words; ///< Words of the distinct blocks, or all blocks if plain.
+	std::vector<std::uint16_t> dict_ones; ///< Number of ones in the distinct blocks.
+	std::size_t index_bits;
+	std::vector<std::uint64_t> index_words; ///< Dictionary indices of the blocks, index_bits each.
+	std::vector<std::size_t> samples; ///< Number of ones before every SampleBlocks blocks.
+};
+
+/// Compute the same boolean vector as computeLessThanMatchTable as a
+/// CompressedBitvector, built on the fly from the words generated by
+/// LessThanMatchTableGenerator without storing the uncompressed table. Uses
+/// O(|Y|) bits of extra space in addition to the compressed bitvector and its
+/// block indices.
+template <typename XI, typename YI, typename Idx = std::size_t>
+CompressedBitvector computeLessThanMatchTableCompressed(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end
+) {
+	LessThanMatchTableGenerator<XI, YI, Idx> gen(x_begin, x_end, y_begin, y_end);
+	return CompressedBitvector::build(
+		(std::size_t)(x_end - x_begin),
+		[&gen]() { return gen.next(); }
+	);
+}
+
+/// Compute the same boolean vector as computeRangeMatchTableToIterator as a
+/// CompressedBitvector, as in computeLessThanMatchTableCompressed. Uses
+/// O(|Y| + |Z|) bits of extra space.
+template <typename XI, typename YI, typename ZI, typename Idx = std::size_t>
+CompressedBitvector computeRangeMatchTableCompressed(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end
+) {
+	LessThanMatchTableGenerator<XI, YI, Idx> y_gen(x_begin, x_end, y_begin, y_end);
+	LessThanMatchTableGenerator<XI, ZI, Idx> z_gen(x_begin, x_end, z_begin, z_end);
+	return CompressedBitvector::build(
+		(std::size_t)(x_end - x_begin),
+		[&y_gen, &z_gen]() { return z_gen.next() & ~y_gen.next(); }
+	);
+}
+
+}
@@ -1,172 +1,444 @@
 #pragma once
 
+#include "util.hpp"
+
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <utility>
 
 // Algorithm for counting the number of string range matches.
 
 namespace srm {
 
+/// Largest k chosen by the automatic selection of k in LessThanCounter.
+const std::size_t maxAutoK = 8;
+
+/// Length of the shortest periodic prefix of Y for which the automatic
+/// selection of k in LessThanCounter tries other candidates than k = 3.
+const std::size_t minAutoPeriodicLength = 64;
+
 /// Workspace for counting the number of suffixes of string X that are
 /// lexicographically smaller than the constant string Y.
 /// String Y must stay constant throughout the lifetime of the workspace.
 /// The characters should be comparable with operators < and ==.
 /// Integer type Idx should be large enough to hold the sizes of strings
-/// X and Y times the parameter k given in constructor.
+/// X and Y times the parameter k given in constructor (maxAutoK if k is
+/// chosen automatically).
+///
+/// If K is nonzero, the parameter k is fixed to K at compile time, so that the
+/// divisions by k in the inner loop compile to multiplications or shifts.
+/// The parameter k given in the constructor must then be equal to K.
+///
+/// If InlineStorage is true, the precomputed tables are stored inline in the
+/// object, so that the workspace makes no heap allocations. The b values in
+/// Sp at least double, so the number of elements in Sp is at most the number
+/// of bits in Idx, which is the capacity of the inline storage. Elements of
+/// Sp cannot be dropped, as without them the scans would fall back to Sn
+/// jumps that may skip unresolved suffixes.
 ///
 /// The algorithm used is the "Linear time and Logarithmic Extra Space"
 /// algorithm described in:
 /// J. Kärkkäinen, D. Kempa, S. Puglisi: String Range Matching. 2014.
-template <typename YI, typename Idx = std::size_t>
+template <
+	typename YI,
+	typename Idx = std::size_t,
+	std::size_t K = 0,
+	bool InlineStorage = false
+>
 class LessThanCounter {
 public:
 	/// Construct the workspace for Y given by random-access iterator range
 	/// [y_begin, y_end).
 	/// Parameter k >= 3 is the parameter for the algorithm described in the
-	/// paper.
-	LessThanCounter(YI y_begin, YI y_end, Idx k = 3)
+	/// paper. If k is 0 (and K is 0), k is chosen automatically by a cost
+	/// model evaluated during construction; the chosen k is returned by getK.
+	LessThanCounter(YI y_begin, YI y_end, Idx k = K != 0 ? (Idx)K : 3)
+		: y_begin(y_begin),
+		  y_end(y_end),
+		  k(k)
+	{
+		assert(k == 0 || k >= 3);
+		assert(K == 0 || k == (Idx)K);
+		
+		if(k == 0) {
+			// Precompute the tables for each candidate and keep the cheapest.
+			// Ties are broken in favor of the smaller k. A larger k makes the
+			// Sn jumps l / k + 1 shorter and keeps Sp entries only for more
+			// strongly periodic prefixes (condition (k - 1) i <= l), which
+			// only pays off by making the binary search over Sp shorter on the
+			// steps where the entries do not help. If no Sp entry
+			// for k = 3 covers a prefix of at least minAutoPeriodicLength
+			// characters, k = 3 is kept without trying the others, so that
+			// the construction cost for non-periodic Y is that of a fixed k.
+			double best_cost = std::numeric_limits<double>::infinity();
+			Idx best_k = 3;
+			for(Idx candidate : {(Idx)3, (Idx)4, (Idx)6, (Idx)maxAutoK}) {
+				this->k = candidate;
+				double cost = precompute();
+				if(candidate == 3 && !hasLongPeriodicPrefix()) return;
+				if(cost < best_cost) {
+					best_cost = cost;
+					best_k = candidate;
+				}
+			}
+			this->k = best_k;
+			if(best_k == (Idx)maxAutoK) return;
+		}
+		precompute();
+	}
+	
+	/// Restore the workspace for Y given by random-access iterator range
+	/// [y_begin, y_end) from its parameter k and the tables returned by
+	/// getSpTable and getSnTable, without recomputing them. The tables are
+	/// given as ranges [sp, sp + sp_size) and [sn, sn + sn_size).
+	LessThanCounter(
+		YI y_begin, YI y_end, Idx k,
+		const Idx* sp, std::size_t sp_size,
+		const Idx* sn, std::size_t sn_size
+	)
 		: y_begin(y_begin),
 		  y_end(y_end),
 		  k(k)
 	{
 		assert(k >= 3);
+		assert(K == 0 || k == (Idx)K);
+		assert(sp_size % 3 == 0 && sn_size % 2 == 0);
 		
-		// Convenience function to index Y.
-		auto Y = [y_begin](Idx i) { return *(y_begin + i); };
+		for(std::size_t t = 0; t < sp_size; t += 3) {
+			pushSp(SpElement{sp[t], sp[t + 1], sp[t + 2]});
+		}
+		clearSn();
+		for(std::size_t t = 0; t < sn_size; t += 2) {
+			pushSn(SnElement{sn[t], sn[t + 1]});
+		}
+	}
+	
+	/// State of a counting scan over the suffixes of a string X, advanced by
+	/// function scan.
+	struct ScanState {
+		Idx i; ///< Starting index of the next suffix to process.
+		Idx l; ///< Known length of the common prefix of X[i, n) and Y.
+		Idx count; ///< Number of processed suffixes less than Y.
+	};
+	
+	/// Return the scan state for starting a scan at index i.
+	static ScanState startScan(Idx i) {
+		return ScanState{i, 0, 0};
+	}
+	
+	/// Advance the counting scan state over string X given by random-access
+	/// iterator range [x_begin, x_end) until state.i >= end. The suffixes
+	/// starting in the range of indices passed over are counted to state.count.
+	/// If end is less than the length of X, the scan stops exactly at
+	/// state.i == end, and therefore a scan can be restarted from any index
+	/// with startScan. Only characters of X at indices less than
+	/// end - 1 + |Y| are accessed.
+	template <typename XI>
+	void scan(XI x_begin, XI x_end, ScanState& state, Idx end) const {
+		scan(x_begin, x_end, state, end, end);
+	}
+	
+	/// Same as scan(x_begin, x_end, state, end), but the scan may pass end
+	/// by the jumps of the algorithm as long as they stay within limit >= end,
+	/// keeping the known common prefix in the state. Advancing a scan over
+	/// consecutive blocks with this and the same limit thus does not match
+	/// the prefix again after each block, and the scan stops exactly at
+	/// limit when it is reached. Only characters of X at indices less than
+	/// limit - 1 + |Y| are accessed.
+	template <typename XI>
+	void scan(XI x_begin, XI x_end, ScanState& state, Idx end, Idx limit) const {
+		assert(end <= limit);
+		
+		// Convenience functions to index X and Y.
+		auto X = [x_begin](Idx i) { return *(x_begin + i); };
+		auto Y = [this](Idx i) { return *(y_begin + i); };
+		Idx n = (Idx)(x_end - x_begin);
 		Idx m = (Idx)(y_end - y_begin);
 		
-		// Precompute Sp and Sn.
-		Sn.push_back(SnElement{1, 0});
+		Idx count = state.count;
+		Idx i = state.i;
+		Idx l = state.l;
 		
-		Idx i = 1;
-		Idx last = 1;
-		Idx l = 0;
-		Idx count = 0;
-		while(i < m) {
-			while(i + l < m && Y(i + l) == Y(l)) ++l;
+		while(i < end) {
+			l += matchLength(x_begin + (i + l), y_begin + l, std::min(n - i, m) - l);
 			
 			SpElement found = findSp(l);
 			Idx b = found.b;
-			Idx e = found.e;
 			Idx c = found.c;
 			
-			if(b == 0 && (k - 1) * i <= l) {
-				b = 2 * i;
-				e = i + l + 1; // Differs from the paper, may be a bug in the paper?
-				c = count;
-				Sp.push_back(SpElement{b, e, c});
-			}
-			if(2 * last <= i) {
-				Sn.push_back(SnElement{i, count});
-				last = i;
-			}
-			if(i + l == m || Y(i + l) < Y(l)) ++count;
-			if(b != 0) {
+			if(l < m && (i + l == n || X(i + l) < Y(l))) ++count;
+			if(b != 0 && b / 2 <= limit - i) {
 				count += c;
 				i += b / 2;
 				l -= b / 2;
 			} else {
-				SnElement pred = predSn(l / k + 1);
+				// If the jump given by Sp would pass limit, we can still use
+				// a shorter jump from Sn, as the suffixes starting in the
+				// first period are resolved within the known prefix.
+				Idx jump = b != 0 ? b / 2 : l / getK() + 1;
+				SnElement pred = predSn(std::min(jump, limit - i));
 				b = pred.b;
 				c = pred.c;
-				
 				count += c;
 				i += b;
 				l = 0;
 			}
 		}
+		
+		state = ScanState{i, l, count};
 	}
 	
 	/// Return the count of suffixes of X lexicographically smaller than Y.
 	/// String X is given by random-access iterator range [x_begin, x_end).
 	template <typename XI>
 	Idx count(XI x_begin, XI x_end) const {
-		// Convenience functions to index X and Y.
-		auto X = [x_begin](Idx i) { return *(x_begin + i); };
+		ScanState state = startScan(0);
+		scan(x_begin, x_end, state, (Idx)(x_end - x_begin));
+		return state.count;
+	}
+	
+	/// Same as count(x_begin, x_end), but splits X into thread_count chunks
+	/// that are scanned in parallel in separate threads. Each chunk reads at
+	/// most |Y| characters past its end.
+	template <typename XI>
+	Idx count(XI x_begin, XI x_end, unsigned thread_count) const {
+		auto count_chunk = [&](Idx begin, Idx end) {
+			ScanState state = startScan(begin);
+			scan(x_begin, x_end, state, end);
+			return state.count;
+		};
+		return sumChunksInParallel<Idx>(
+			(Idx)(x_end - x_begin), thread_count, count_chunk
+		);
+	}
+	
+	/// Return the parameter k of the algorithm.
+	Idx getK() const {
+		return K != 0 ? (Idx)K : k;
+	}
+	
+	/// Return the precomputed list Sp as a flat array of triples (b, e, c).
+	std::vector<Idx> getSpTable() const {
+		std::vector<Idx> ret;
+		for(std::size_t t = 0; t < sp_b.size(); ++t) {
+			ret.push_back(sp_b[t]);
+			ret.push_back(sp_e[t]);
+			ret.push_back(sp_c[t]);
+		}
+		return ret;
+	}
+	
+	/// Return the precomputed list Sn as a flat array of pairs (b, c).
+	std::vector<Idx> getSnTable() const {
+		// Each element is the last element of the buckets starting from the
+		// bucket of its b.
+		std::vector<Idx> ret;
+		for(int t = 0; t <= snTop(); ++t) {
+			const SnBucket& bucket = sn_bucket[t];
+			if(ret.empty() || ret[ret.size() - 2] != bucket.last.b) {
+				ret.push_back(bucket.last.b);
+				ret.push_back(bucket.last.c);
+			}
+		}
+		return ret;
+	}
+	
+private:
+	YI y_begin;
+	YI y_end;
+	Idx k;
+	
+	struct SpElement {
+		Idx b;
+		Idx e;
+		Idx c;
+	};
+	struct SnElement {
+		Idx b;
+		Idx c;
+	};
+	
+	typedef typename std::conditional<
+		InlineStorage,
+		InlineVector<Idx, std::numeric_limits<Idx>::digits>,
+		std::vector<Idx>
+	>::type SpArray;
+	
+	// List Sp precomputed for Y sorted by b, stored as separate arrays for
+	// each field so that the binary search only touches the array sp_b.
+	SpArray sp_b;
+	SpArray sp_e;
+	SpArray sp_c;
+	
+	// List Sn precomputed for Y is sorted by b and each b is at least two times
+	// the previous one, and thus each range [2^t, 2^(t + 1)) contains at most
+	// one b. Instead of the list, we store for each t the last element with
+	// b < 2^(t + 1) and its predecessor, so that predSn is a table lookup.
+	// predSn is only called with x <= max(|Y|, 1), so only the buckets up to
+	// t = snTop() are used and initialized.
+	struct SnBucket {
+		SnElement last;
+		SnElement prev;
+	};
+	SnBucket sn_bucket[std::numeric_limits<Idx>::digits];
+	
+	/// Compute Sp and Sn for Y with the current k. Returns the estimated cost
+	/// per character of a counting scan with the tables, in nanoseconds. The
+	/// estimate is based on the number of steps and character comparisons
+	/// made when the computation scans the suffixes of Y itself, and the
+	/// length of the binary search over Sp in each step, which reflects how
+	/// well the tables skip over periodic parts of Y and what they cost when
+	/// they do not.
+	double precompute() {
+		// Costs of a compared character, a step and an iteration of the binary
+		// search over Sp, fitted by least squares to the differences between
+		// the candidates of k in the counting times of benchmark count-k-auto
+		// of microbenchmark.cpp and in the counts computed here.
+		const double char_cost = 0.32;
+		const double step_cost = 8.9;
+		const double search_cost = 2.05;
+		
+		// Convenience function to index Y.
 		auto Y = [this](Idx i) { return *(y_begin + i); };
-		Idx n = (Idx)(x_end - x_begin);
 		Idx m = (Idx)(y_end - y_begin);
 		
-		Idx count = 0;
-		Idx i = 0;
-		Idx l = 0;
+		sp_b.clear();
+		sp_e.clear();
+		sp_c.clear();
+		clearSn();
 		
-		while(i < n) {
-			while(i + l < n && l < m && X(i + l) == Y(l)) ++l;
+		Idx i = 1;
+		Idx last = 1;
+		Idx l = 0;
+		Idx count = 0;
+		std::size_t steps = 0;
+		std::size_t compared = 0;
+		while(i < m) {
+			Idx match = matchLength(y_begin + (i + l), y_begin + l, m - (i + l));
+			l += match;
+			++steps;
+			compared += match + 1;
 			
 			SpElement found = findSp(l);
 			Idx b = found.b;
+			Idx e = found.e;
 			Idx c = found.c;
 			
-			if(l < m && (i + l == n || X(i + l) < Y(l))) ++count;
+			if(b == 0 && (k - 1) * i <= l) {
+				b = 2 * i;
+				e = i + l + 1; // Differs from the paper, may be a bug in the paper?
+				c = count;
+				pushSp(SpElement{b, e, c});
+			}
+			if(2 * last <= i) {
+				pushSn(SnElement{i, count});
+				last = i;
+			}
+			if(i + l == m || Y(i + l) < Y(l)) ++count;
 			if(b != 0) {
 				count += c;
 				i += b / 2;
 				l -= b / 2;
 			} else {
-				SnElement pred = predSn(l / k + 1);
+				SnElement pred = predSn(l / getK() + 1);
 				b = pred.b;
 				c = pred.c;
+				
 				count += c;
 				i += b;
 				l = 0;
 			}
 		}
 		
-		return count;
+		if(m <= 1) return 0.0;
+		double step = step_cost + search_cost * spSearchLength();
+		return (char_cost * compared + step * steps) / (m - 1);
 	}
 	
-private:
-	YI y_begin;
-	YI y_end;
-	Idx k;
+	/// Return the number of iterations of the binary search in findSp.
+	int spSearchLength() const {
+		std::size_t size = sp_b.size();
+		return size <= 1 ? 0 : floorLog2(size - 1) + 1;
+	}
 	
-	struct SpElement {
-		Idx b;
-		Idx e;
-		Idx c;
-	};
-	struct SnElement {
-		Idx b;
-		Idx c;
-	};
-	std::vector<SpElement> Sp; ///< List Sp precomputed for Y, sorted by b.
-	std::vector<SnElement> Sn; ///< List Sn precomputed for Y, sorted by b.
+	/// Return true if an element of Sp has e >= minAutoPeriodicLength, that
+	/// is, Sp covers a long periodic prefix of Y.
+	bool hasLongPeriodicPrefix() const {
+		for(std::size_t t = 0; t < sp_e.size(); ++t) {
+			if(sp_e[t] >= (Idx)minAutoPeriodicLength) return true;
+		}
+		return false;
+	}
+	
+	/// Add element to the end of Sp.
+	void pushSp(SpElement elem) {
+		assert(!InlineStorage || sp_b.size() < (std::size_t)std::numeric_limits<Idx>::digits);
+		sp_b.push_back(elem.b);
+		sp_e.push_back(elem.e);
+		sp_c.push_back(elem.c);
+	}
+	
+	/// Return the index of the last used bucket of Sn.
+	int snTop() const {
+		return floorLog2(std::max((Idx)(y_end - y_begin), (Idx)1));
+	}
+	
+	/// Set Sn to contain only the first element, which is always {1, 0}.
+	void clearSn() {
+		for(int t = 0; t <= snTop(); ++t) {
+			sn_bucket[t] = SnBucket{SnElement{1, 0}, SnElement{0, 0}};
+		}
+	}
+	
+	/// Add element to the end of Sn.
+	void pushSn(SnElement elem) {
+		int top = snTop();
+		SnElement prev = sn_bucket[top].last;
+		for(int t = floorLog2(elem.b); t <= top; ++t) {
+			sn_bucket[t] = SnBucket{elem, prev};
+		}
+	}
 	
 	/// Returns the element in Sp such that b <= x < e, or if none is found,
 	/// returns {0, 0, 0}.
 	SpElement findSp(Idx x) const {
-		// Find the element using binary search.
-		SpElement elem{x, 0, 0};
-		auto cmp = [](const SpElement& a, const SpElement& b) {
-			return a.b < b.b;
-		};
-		auto it = std::upper_bound(Sp.begin(), Sp.end(), elem, cmp);
+		std::size_t size = sp_b.size();
+		if(size == 0) return SpElement{0, 0, 0};
+		
+		// Branch-free binary search for the last element with b <= x. After
+		// the loop, that element is at base unless all elements have b > x.
+		const Idx* base = sp_b.data();
+		while(size > 1) {
+			std::size_t half = size / 2;
+			base = base[half] <= x ? base + half : base;
+			size -= half;
+		}
+		std::size_t index = base - sp_b.data();
 		
-		// Now 'it' contains the first Sp element with b > x.
-		if(it == Sp.begin()) return SpElement{0, 0, 0};
-		--it;
-		if(it->e <= x) return SpElement{0, 0, 0};
-		return *it;
+		if(*base > x || sp_e[index] <= x) return SpElement{0, 0, 0};
+		return SpElement{*base, sp_e[index], sp_c[index]};
 	}
 	
 	/// Returns the element in Sn such that b <= x and b is as large as
-	/// possible. Assumes that such an element exists.
+	/// possible. Assumes that x >= 1.
 	SnElement predSn(Idx x) const {
-		// Find the element using binary search.
-		SnElement elem{x, 0};
-		auto cmp = [](const SnElement& a, const SnElement& b) {
-			return a.b < b.b;
-		};
-		auto it = std::upper_bound(Sn.begin(), Sn.end(), elem, cmp);
+		assert(x >= 1);
 		
-		// Now 'it' contains the first Sp element with b > x.
-		assert(it != Sn.begin());
+		// Sn always starts with b = 1, and jumps by one are the common case
+		// for random-like Y.
+		if(x == 1) return SnElement{1, 0};
 		
-		--it;
-		return *it;
+		// The element with b in [2^t, 2^(t + 1)) for t = floor(log2(x)) is
+		// the last element with b < 2^(t + 1), if it exists. If it has b > x,
+		// the previous element has b < 2^t <= x.
+		const SnBucket& bucket = sn_bucket[floorLog2(x)];
+		return bucket.last.b <= x ? bucket.last : bucket.prev;
 	}
 };
 
@@ -176,6 +448,104 @@ LessThanCounter<YI, Idx> makeLessThanCounter(YI y_begin, YI y_end, Idx k = 3) {
 	return LessThanCounter<YI, Idx>(y_begin, y_end, k);
 }
 
+/// Equivalent to constructor of LessThanCounter of appropriate type with
+/// parameter k fixed to K at compile time, called as
+/// makeLessThanCounter<K>(y_begin, y_end).
+template <std::size_t K, typename YI, typename Idx = std::size_t>
+LessThanCounter<YI, Idx, K> makeLessThanCounter(YI y_begin, YI y_end) {
+	return LessThanCounter<YI, Idx, K>(y_begin, y_end);
+}
+
+/// LessThanCounter with the precomputed tables stored inline, making no heap
+/// allocations.
+template <typename YI, typename Idx = std::size_t, std::size_t K = 0>
+using InlineLessThanCounter = LessThanCounter<YI, Idx, K, true>;
+
+/// Equivalent to constructor of InlineLessThanCounter of appropriate type.
+template <typename YI, typename Idx = std::size_t>
+InlineLessThanCounter<YI, Idx> makeInlineLessThanCounter(YI y_begin, YI y_end, Idx k = 3) {
+	return InlineLessThanCounter<YI, Idx>(y_begin, y_end, k);
+}
+
+/// Returns true if integer type Idx is large enough for counting over string X
+/// of length n with string Y of length m and parameter k, that is, if Idx can
+/// hold n and k * m. For k = 0 (automatic k), the largest possible k is used.
+template <typename Idx>
+bool indexTypeFits(std::size_t n, std::size_t m, std::size_t k) {
+	if(k == 0) k = maxAutoK;
+	std::size_t max = (std::size_t)std::numeric_limits<Idx>::max();
+	return n <= max && m <= max / k;
+}
+
+/// Return the count of suffixes of X lexicographically smaller than Y. Strings
+/// X and Y are given by random-access iterator ranges [x_begin, x_end) and
+/// [y_begin, y_end). Uses LessThanCounter with 32-bit indices if they are
+/// large enough, halving the size of the precomputed tables.
+template <typename XI, typename YI>
+std::size_t countLessThan(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	std::size_t k = 3
+) {
+	std::size_t n = x_end - x_begin;
+	std::size_t m = y_end - y_begin;
+	if(indexTypeFits<std::uint32_t>(n, m, k)) {
+		return LessThanCounter<YI, std::uint32_t>(
+			y_begin, y_end, (std::uint32_t)k
+		).count(x_begin, x_end);
+	} else {
+		return LessThanCounter<YI>(y_begin, y_end, k).count(x_begin, x_end);
+	}
+}
+
+/// Run the counting scans of a batch of counters (LessThanCounters or
+/// RangeCounters of the same type) given as a vector over string X given by
+/// random-access iterator range [x_begin, x_end). Returns the final scan
+/// states such that the state of counter j in chunk c is at index
+/// c * counters.size() + j. The total count for a counter is the sum of the
+/// counts in its states.
+///
+/// X is split into chunks that are distributed over thread_count threads
+/// with work stealing, or one thread if thread_count is 0. Each chunk is
+/// processed in blocks such that all the counters are advanced over a block
+/// while it is in cache, and therefore X is streamed from memory only once
+/// regardless of the number of counters.
+/// The jumps of the scans are carried over the block ends within a chunk.
+template <typename Idx, typename XI, typename Counter>
+std::vector<typename Counter::ScanState> scanBatch(
+	XI x_begin, XI x_end,
+	const std::vector<Counter>& counters,
+	unsigned thread_count = 1
+) {
+	typedef typename Counter::ScanState ScanState;
+	
+	Idx n = (Idx)(x_end - x_begin);
+	std::size_t q = counters.size();
+	
+	// Use more chunks than threads to balance the work.
+	Idx chunk_count = std::min(n, (Idx)(thread_count <= 1 ? 1 : 4 * thread_count));
+	std::vector<ScanState> states(chunk_count * q);
+	
+	auto process_chunk = [&](std::size_t chunk) {
+		Idx begin = splitPoint<Idx>(n, chunk_count, chunk);
+		Idx end = splitPoint<Idx>(n, chunk_count, chunk + 1);
+		
+		ScanState* chunk_states = states.data() + chunk * q;
+		std::fill(chunk_states, chunk_states + q, Counter::startScan(begin));
+		
+		Idx pos = begin;
+		while(pos < end) {
+			pos += std::min((Idx)scanBlockSize(), end - pos);
+			for(std::size_t j = 0; j < q; ++j) {
+				counters[j].scan(x_begin, x_end, chunk_states[j], pos, end);
+			}
+		}
+	};
+	runTasksInParallel(chunk_count, thread_count, process_chunk);
+	
+	return states;
+}
+
 /// Same as LessThanCounter, but instead of counting the suffixes of X less
 /// less than Y, computes the suffixes of X in range [Y, Z). Y is assumed to
 /// be lexicographically less than or equal to Z.
@@ -187,7 +557,8 @@ public:
 	/// [y_begin, y_end) and [z_begin, z_end).
 	/// Parameters ky, kz >= 3 are the parameters for the algorithm described in
 	/// the paper.
-	/// ky is used for bound Y and kz for bound Z.
+	/// ky is used for bound Y and kz for bound Z. Either can be 0 to choose it
+	/// automatically, see LessThanCounter.
 	RangeCounter(
 		YI y_begin, YI y_end,
 		ZI z_begin, ZI z_end,
@@ -197,16 +568,82 @@ public:
 		  z_counter(z_begin, z_end, kz)
 	{ }
 	
+	/// State of a counting scan over the suffixes of a string X, advanced by
+	/// function scan.
+	struct ScanState {
+		typename LessThanCounter<YI, Idx>::ScanState y; ///< Scan state for Y.
+		typename LessThanCounter<ZI, Idx>::ScanState z; ///< Scan state for Z.
+		
+		/// Number of processed suffixes in range [Y, Z).
+		Idx count() const {
+			return z.count - y.count;
+		}
+	};
+	
+	/// Return the scan state for starting a scan at index i.
+	static ScanState startScan(Idx i) {
+		return ScanState{
+			LessThanCounter<YI, Idx>::startScan(i),
+			LessThanCounter<ZI, Idx>::startScan(i)
+		};
+	}
+	
+	/// Advance the counting scan state over string X given by random-access
+	/// iterator range [x_begin, x_end) until both bounds have passed end,
+	/// passing it by jumps at most up to limit. See LessThanCounter::scan for
+	/// details.
+	template <typename XI>
+	void scan(XI x_begin, XI x_end, ScanState& state, Idx end, Idx limit) const {
+		z_counter.scan(x_begin, x_end, state.z, end, limit);
+		y_counter.scan(x_begin, x_end, state.y, end, limit);
+	}
+	
+	/// Same as scan(x_begin, x_end, state, end, end).
+	template <typename XI>
+	void scan(XI x_begin, XI x_end, ScanState& state, Idx end) const {
+		scan(x_begin, x_end, state, end, end);
+	}
+	
 	/// Return the count of suffixes of X lexicographically in range [Y, Z).
 	/// String X is given by random-access iterator range [x_begin, x_end).
+	/// The scans for Y and Z are advanced alternately over short blocks of X,
+	/// so that X is streamed from memory only once. The jumps of the scans
+	/// are carried over the block ends, so the blocks add no matching work.
 	template <typename XI>
 	Idx count(XI x_begin, XI x_end) const {
-		return z_counter.count(x_begin, x_end) - y_counter.count(x_begin, x_end);
+		return countChunk(x_begin, x_end, 0, (Idx)(x_end - x_begin));
+	}
+	
+	/// Same as count(x_begin, x_end), but scans X in parallel in thread_count
+	/// threads. See LessThanCounter::count for details.
+	template <typename XI>
+	Idx count(XI x_begin, XI x_end, unsigned thread_count) const {
+		auto count_chunk = [&](Idx begin, Idx end) {
+			return countChunk(x_begin, x_end, begin, end);
+		};
+		return sumChunksInParallel<Idx>(
+			(Idx)(x_end - x_begin), thread_count, count_chunk
+		);
 	}
 	
 private:
 	LessThanCounter<YI, Idx> y_counter; /// Counter for range ["", Y).
 	LessThanCounter<ZI, Idx> z_counter; /// Counter for range ["", Z).
+	
+	/// Return the count of suffixes of X in range [Y, Z) starting in
+	/// [begin, end).
+	template <typename XI>
+	Idx countChunk(XI x_begin, XI x_end, Idx begin, Idx end) const {
+		ScanState state = startScan(begin);
+		
+		Idx pos = begin;
+		while(pos < end) {
+			pos += std::min((Idx)scanBlockSize(), end - pos);
+			scan(x_begin, x_end, state, pos, end);
+		}
+		
+		return state.count();
+	}
 };
 
 /// Equivalent to constructor of RangeCounter of appropriate type.
@@ -219,4 +656,105 @@ RangeCounter<YI, ZI, Idx> makeRangeCounter(
 	return RangeCounter<YI, ZI, Idx>(y_begin, y_end, z_begin, z_end, ky, kz);
 }
 
+/// Return the count of suffixes of X lexicographically in range [Y, Z), where
+/// Y is assumed to be lexicographically less than or equal to Z. Strings X, Y
+/// and Z are given by random-access iterator ranges [x_begin, x_end),
+/// [y_begin, y_end) and [z_begin, z_end). Uses RangeCounter with 32-bit indices
+/// if they are large enough, halving the size of the precomputed tables.
+template <typename XI, typename YI, typename ZI>
+std::size_t countRangeMatches(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end,
+	std::size_t k = 3
+) {
+	std::size_t n = x_end - x_begin;
+	std::size_t m = std::max<std::size_t>(y_end - y_begin, z_end - z_begin);
+	if(indexTypeFits<std::uint32_t>(n, m, k)) {
+		return RangeCounter<YI, ZI, std::uint32_t>(
+			y_begin, y_end, z_begin, z_end, (std::uint32_t)k, (std::uint32_t)k
+		).count(x_begin, x_end);
+	} else {
+		return RangeCounter<YI, ZI>(
+			y_begin, y_end, z_begin, z_end, k, k
+		).count(x_begin, x_end);
+	}
+}
+
+/// Count the suffixes of string X in the ranges of a batch of range counters
+/// given as a vector. String X is given by random-access iterator range
+/// [x_begin, x_end). Returns a vector containing the count for each counter.
+/// The scans are run using scanBatch in thread_count threads.
+template <typename XI, typename YI, typename ZI, typename Idx>
+std::vector<Idx> countRangeMatchesBatch(
+	XI x_begin, XI x_end,
+	const std::vector<RangeCounter<YI, ZI, Idx>>& counters,
+	unsigned thread_count = 1
+) {
+	std::vector<Idx> counts(counters.size(), 0);
+	auto states = scanBatch<Idx>(x_begin, x_end, counters, thread_count);
+	for(std::size_t t = 0; t < states.size(); ++t) {
+		counts[t % counters.size()] += states[t].count();
+	}
+	return counts;
+}
+
+/// Workspace for counting the number of suffixes of string X in each of the
+/// buckets delimited by constant boundary strings B_1 < B_2 < ... < B_b. Bucket
+/// 0 contains the suffixes less than B_1, bucket j the suffixes in range
+/// [B_j, B_{j + 1}) and bucket b the suffixes greater than or equal to B_b.
+/// The boundary strings must stay constant throughout the lifetime of the
+/// workspace. See LessThanCounter for more details. The bucket of each suffix
+/// can be computed with computeBucketTableToIterator.
+template <typename BI, typename Idx = std::size_t>
+class BucketCounter {
+public:
+	/// Construct the workspace for boundaries given as a vector of random-access
+	/// iterator ranges, sorted in increasing lexicographical order.
+	/// Parameter k >= 3 is the parameter for the algorithm described in the
+	/// paper.
+	BucketCounter(const std::vector<std::pair<BI, BI>>& boundaries, Idx k = 3) {
+		for(const std::pair<BI, BI>& boundary : boundaries) {
+			counters.emplace_back(boundary.first, boundary.second, k);
+		}
+	}
+	
+	/// Return the counts of suffixes of X in each bucket as a vector of length
+	/// b + 1. String X is given by random-access iterator range
+	/// [x_begin, x_end). The counts are computed in a single pass over X for
+	/// all the boundaries, using scanBatch with thread_count threads.
+	template <typename XI>
+	std::vector<Idx> count(XI x_begin, XI x_end, unsigned thread_count = 1) const {
+		std::size_t b = counters.size();
+		
+		// less[j] is the number of suffixes less than B_{j + 1}.
+		std::vector<Idx> less(b + 1, 0);
+		auto states = scanBatch<Idx>(x_begin, x_end, counters, thread_count);
+		for(std::size_t t = 0; t < states.size(); ++t) {
+			less[t % b] += states[t].count;
+		}
+		less[b] = (Idx)(x_end - x_begin);
+		
+		std::vector<Idx> histogram(b + 1);
+		Idx prev = 0;
+		for(std::size_t j = 0; j <= b; ++j) {
+			histogram[j] = less[j] - prev;
+			prev = less[j];
+		}
+		return histogram;
+	}
+	
+private:
+	std::vector<LessThanCounter<BI, Idx>> counters; ///< Counter for each boundary.
+};
+
+/// Equivalent to constructor of BucketCounter of appropriate type.
+template <typename BI, typename Idx = std::size_t>
+BucketCounter<BI, Idx> makeBucketCounter(
+	const std::vector<std::pair<BI, BI>>& boundaries,
+	Idx k = 3
+) {
+	return BucketCounter<BI, Idx>(boundaries, k);
+}
+
 }
@@ -74,32 +74,43 @@ Idx computeStringPeriod(XI x_begin, XI x_end) {
 	return per;
 }
 
-/// Compute the starting positions in which string P occurs in string T.
-/// Strings P and T are given as random-access iterator ranges [p_begin, p_end)
-/// and [t_begin, t_end). The result indices are passed in order to function
-/// output.
-///
-/// The characters should be comparable with operators < and ==.
-/// Integer type Idx should be large enough to hold the sizes of strings P and T .
-///
-/// The algorithm used is the "POSITIONS" algorithm described in:
-/// M. Crochemore. String-matching on ordered alphabets. Theoretical Computer Science,
-/// 92:33–47, 1992.
-///
-/// The algorithm runs in linear time and constant space.
+/// State of a scan reporting the occurrences of a string P in a string T,
+/// advanced by function scanExactStringMatches.
+template <typename Idx>
+struct ExactMatchScanState {
+	Idx pos; ///< Next starting position of T to check.
+	Idx m; ///< One plus the length of the known match of P at pos.
+	MSTuple<Idx> ms;
+};
+
+/// Return the scan state for starting a scan of exact string matches.
+template <typename Idx>
+ExactMatchScanState<Idx> startExactMatchScan() {
+	return ExactMatchScanState<Idx>{0, 1, MSTuple<Idx>{0, 1, 1}};
+}
+
+/// Advance the scan state of reporting the starting positions in which string
+/// P occurs in string T until state.pos >= end. See reportExactStringMatches
+/// for details. The scan is complete when state.pos > |T|.
 template <typename PI, typename TI, typename F, typename Idx = std::size_t>
-void reportExactStringMatches(PI p_begin, PI p_end, TI t_begin, TI t_end, F output) {
+void scanExactStringMatches(
+	PI p_begin, PI p_end,
+	TI t_begin, TI t_end,
+	ExactMatchScanState<Idx>& state, Idx end,
+	F& output
+) {
 	// Convenience functions to index P and X.
 	auto P = [p_begin](Idx i) -> decltype(*p_begin) { return *(p_begin + i); };
 	auto T = [t_begin](Idx i) -> decltype(*t_begin) { return *(t_begin + i); };
 	Idx k = (Idx)(p_end - p_begin);
 	Idx n = (Idx)(t_end - t_begin);
 	
-	Idx pos = 0;
-	Idx m = 1;
-	MSTuple<Idx> ms{0, 1, 1};
+	Idx pos = state.pos;
+	Idx m = state.m;
+	MSTuple<Idx> ms = state.ms;
 	
-	while(pos <= n) {
+	end = std::min(end, n + 1);
+	while(pos < end) {
 		while(pos + m <= n && m <= k && T(pos + m - 1) == P(m - 1)) ++m;
 		if(m == k + 1) output(pos);
 		if(pos + m == n + 1) --m;
@@ -138,6 +149,29 @@ void reportExactStringMatches(PI p_begin, PI p_end, TI t_begin, TI t_end, F outp
 			ms = MSTuple<Idx>{0, 1, 1};
 		}
 	}
+	
+	state = ExactMatchScanState<Idx>{pos, m, ms};
+}
+
+/// Compute the starting positions in which string P occurs in string T.
+/// Strings P and T are given as random-access iterator ranges [p_begin, p_end)
+/// and [t_begin, t_end). The result indices are passed in order to function
+/// output.
+///
+/// The characters should be comparable with operators < and ==.
+/// Integer type Idx should be large enough to hold the sizes of strings P and T .
+///
+/// The algorithm used is the "POSITIONS" algorithm described in:
+/// M. Crochemore. String-matching on ordered alphabets. Theoretical Computer Science,
+/// 92:33–47, 1992.
+///
+/// The algorithm runs in linear time and constant space.
+template <typename PI, typename TI, typename F, typename Idx = std::size_t>
+void reportExactStringMatches(PI p_begin, PI p_end, TI t_begin, TI t_end, F output) {
+	ExactMatchScanState<Idx> state = startExactMatchScan<Idx>();
+	scanExactStringMatches<PI, TI, F, Idx>(
+		p_begin, p_end, t_begin, t_end, state, (Idx)(t_end - t_begin) + 1, output
+	);
 }
 
 }
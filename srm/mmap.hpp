@@ -0,0 +1,454 @@
+#pragma once
+
+#include "table.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Memory-mapped file input and output for the string range matching
+// algorithms. POSIX specific.
+
+namespace srm {
+
+/// Throw std::system_error with given message for error code err.
+inline void throwSystemError(const std::string& msg, int err = errno) {
+	throw std::system_error(err, std::system_category(), msg);
+}
+
+/// Read-only memory mapping of a whole file. The contents of the file are
+/// exposed as random-access iterator range [begin(), end()) of characters that
+/// can be passed directly to the string range matching algorithms without
+/// copying the file to memory.
+class MappedFile {
+public:
+	/// Map the file in given path. The kernel is advised that the mapping is
+	/// accessed sequentially and may be backed by huge pages. If populate is
+	/// true, the whole file is read to memory already while mapping it.
+	/// Throws std::system_error if opening or mapping the file fails.
+	explicit MappedFile(const std::string& path, bool populate = false)
+		: data(nullptr),
+		  length(0)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd == -1) throwSystemError("Opening file " + path + " failed");
+		
+		struct stat st;
+		if(fstat(fd, &st) == -1) {
+			int err = errno;
+			close(fd);
+			throwSystemError("Reading size of file " + path + " failed", err);
+		}
+		length = (std::size_t)st.st_size;
+		
+		// Empty files cannot be mapped.
+		if(length != 0) {
+			int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			if(populate) flags |= MAP_POPULATE;
+#endif
+			void* addr = mmap(nullptr, length, PROT_READ, flags, fd, 0);
+			if(addr == MAP_FAILED) {
+				int err = errno;
+				close(fd);
+				throwSystemError("Mapping file " + path + " failed", err);
+			}
+			data = (const char*)addr;
+			
+			// The advice is only a hint, so failures are ignored.
+			madvise(addr, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+			madvise(addr, length, MADV_HUGEPAGE);
+#endif
+		}
+		
+		close(fd);
+	}
+	
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	
+	MappedFile(MappedFile&& other)
+		: data(other.data),
+		  length(other.length)
+	{
+		other.data = nullptr;
+		other.length = 0;
+	}
+	
+	~MappedFile() {
+		if(data != nullptr) munmap((void*)data, length);
+	}
+	
+	/// Return iterator to the first character of the file.
+	const char* begin() const {
+		return data;
+	}
+	
+	/// Return iterator past the last character of the file.
+	const char* end() const {
+		return data + length;
+	}
+	
+	/// Return the size of the file in characters.
+	std::size_t size() const {
+		return length;
+	}
+	
+private:
+	const char* data;
+	std::size_t length;
+};
+
+/// Packed bitvector stored in a memory-mapped file. The file consists of a
+/// magic number identifying the format and its version and the number of bits
+/// n as 64-bit integers, the W = packedWordCount(n) words of
+/// the packed bitvector (see packedWordCount) and ceil(W / SampleWords) + 1
+/// rank samples, the number of ones before every SampleWords words and in
+/// the whole bitvector as 64-bit integers. Everything is in the byte order of
+/// the machine, so that a bitvector written to a file can be mapped back in
+/// and used directly, including rank and select queries.
+class MappedBitvector {
+public:
+	static const std::size_t SampleWords = 32;
+	static const std::uint64_t magic_value = 0x31565449424d5253; // "SRMBITV1"
+	
+	/// Create a bitvector file of n zero bits in given path, replacing an
+	/// existing file, and map it for writing. The writes go to the file
+	/// through a shared mapping. The words must be written in order, calling
+	/// release to complete the rank samples of the written words; the file
+	/// is complete after release(packedWordCount(n)).
+	/// The disk space of the file is allocated in advance, so that the writes
+	/// cannot fail for lack of space.
+	/// Throws std::system_error if creating, allocating or mapping the file
+	/// fails.
+	static MappedBitvector create(const std::string& path, std::size_t n) {
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(fd == -1) throwSystemError("Creating file " + path + " failed");
+		
+		std::size_t length = fileLength(n);
+		if(ftruncate(fd, (off_t)length) == -1) {
+			int err = errno;
+			close(fd);
+			throwSystemError("Resizing file " + path + " failed", err);
+		}
+		
+		// Without allocating the blocks, the file would be sparse, and a
+		// write through the mapping to a full disk would raise SIGBUS.
+		int alloc_err = posix_fallocate(fd, 0, (off_t)length);
+		if(alloc_err != 0) {
+			close(fd);
+			throwSystemError("Allocating disk space for file " + path + " failed", alloc_err);
+		}
+		
+		void* addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		int err = errno;
+		close(fd);
+		if(addr == MAP_FAILED) throwSystemError("Mapping file " + path + " failed", err);
+		
+		std::uint64_t header[2] = {magic_value, (std::uint64_t)n};
+		std::memcpy(addr, header, 16);
+		return MappedBitvector((char*)addr, length, n);
+	}
+	
+	/// Map the bitvector file in given path read-only.
+	/// Throws std::system_error if opening or mapping the file fails, and
+	/// std::runtime_error if the file is not a valid bitvector file.
+	static MappedBitvector load(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd == -1) throwSystemError("Opening file " + path + " failed");
+		
+		struct stat st;
+		if(fstat(fd, &st) == -1) {
+			int err = errno;
+			close(fd);
+			throwSystemError("Reading size of file " + path + " failed", err);
+		}
+		std::size_t length = (std::size_t)st.st_size;
+		if(length < 16) {
+			close(fd);
+			throw std::runtime_error("Bitvector file " + path + " is truncated");
+		}
+		
+		void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		int err = errno;
+		close(fd);
+		if(addr == MAP_FAILED) throwSystemError("Mapping file " + path + " failed", err);
+		
+		std::uint64_t header[2];
+		std::memcpy(header, addr, 16);
+		std::uint64_t bit_count = header[1];
+		MappedBitvector ret((char*)addr, length, (std::size_t)bit_count);
+		if(header[0] != magic_value) {
+			throw std::runtime_error("Bitvector file " + path + " has invalid format");
+		}
+		if(
+			bit_count > 64 * (std::uint64_t)length ||
+			fileLength((std::size_t)bit_count) != length ||
+			!ret.validSamples()
+		) {
+			throw std::runtime_error("Bitvector file " + path + " is corrupted");
+		}
+		
+		return ret;
+	}
+	
+	MappedBitvector(const MappedBitvector&) = delete;
+	MappedBitvector& operator=(const MappedBitvector&) = delete;
+	
+	MappedBitvector(MappedBitvector&& other)
+		: data(other.data),
+		  length(other.length),
+		  bit_count(other.bit_count),
+		  released(other.released),
+		  sampled_words(other.sampled_words),
+		  sampled_ones(other.sampled_ones)
+	{
+		other.data = nullptr;
+		other.length = 0;
+		other.bit_count = 0;
+		other.released = 0;
+	}
+	
+	~MappedBitvector() {
+		if(data != nullptr) munmap(data, length);
+	}
+	
+	/// Return the number of bits in the bitvector.
+	std::size_t size() const {
+		return bit_count;
+	}
+	
+	/// Return bit i of the bitvector.
+	bool operator[](std::size_t i) const {
+		return getPackedBit(words(), i);
+	}
+	
+	/// Return pointer to the packedWordCount(size()) words of the bitvector.
+	/// The words may only be written if the bitvector was created by create.
+	std::uint64_t* words() {
+		return (std::uint64_t*)(data + 16);
+	}
+	
+	const std::uint64_t* words() const {
+		return (const std::uint64_t*)(data + 16);
+	}
+	
+	/// Return the number of ones in the bitvector.
+	std::size_t count() const {
+		return (std::size_t)samples()[sampleCount() - 1];
+	}
+	
+	/// Return the number of ones in positions [0, i), where i <= size().
+	std::size_t rank(std::size_t i) const {
+		assert(i <= bit_count);
+		const std::uint64_t* w = words();
+		std::size_t word = i / 64;
+		std::size_t ret = (std::size_t)samples()[word / SampleWords];
+		for(std::size_t t = word - word % SampleWords; t < word; ++t) {
+			ret += popCount(w[t]);
+		}
+		if(i % 64 != 0) ret += popCount(w[word] & lowBitMask(i % 64));
+		return ret;
+	}
+	
+	/// Return the position of the one with rank k, i.e. the (k + 1)th one,
+	/// where k < count().
+	std::size_t select(std::size_t k) const {
+		assert(k < count());
+		const std::uint64_t* sample_begin = samples();
+		const std::uint64_t* sample_end = sample_begin + sampleCount();
+		std::size_t s = std::upper_bound(sample_begin, sample_end, (std::uint64_t)k) - sample_begin - 1;
+		k -= (std::size_t)sample_begin[s];
+		
+		const std::uint64_t* w = words();
+		std::size_t word = s * SampleWords;
+		while(true) {
+			std::size_t word_ones = popCount(w[word]);
+			if(k < word_ones) break;
+			k -= word_ones;
+			++word;
+			assert(word < packedWordCount(bit_count));
+		}
+		return 64 * word + selectInWord(w[word], (int)k);
+	}
+	
+	/// Compute the rank samples of the words [0, word_end), write the words to
+	/// the file and release the whole pages containing them from memory, so
+	/// that the resident memory stays bounded while writing the bitvector in
+	/// order. Only the words after the part released by the previous calls
+	/// are processed. The released words can still be accessed, in which case
+	/// they are read back from the file. Throws std::system_error if writing
+	/// to the file fails.
+	void release(std::size_t word_end) {
+		const std::uint64_t* w = words();
+		std::uint64_t* sample = samples();
+		for(; sampled_words < word_end; ++sampled_words) {
+			sampled_ones += popCount(w[sampled_words]);
+			
+			// After the last word of each group and of the bitvector, store
+			// the sample for the next group.
+			if(
+				(sampled_words + 1) % SampleWords == 0 ||
+				sampled_words + 1 == packedWordCount(bit_count)
+			) {
+				sample[(sampled_words + SampleWords) / SampleWords] = sampled_ones;
+			}
+		}
+		
+		std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+		std::size_t end = (16 + 8 * word_end) / page * page;
+		if(end > released) {
+			sync(released, end);
+			
+			// The advice only affects the memory use, so failures are ignored.
+			madvise(data + released, end - released, MADV_DONTNEED);
+			released = end;
+		}
+		
+		// After the last word, also write the rest of the file, including the
+		// rank samples.
+		if(word_end == packedWordCount(bit_count)) sync(released, length);
+	}
+	
+private:
+	char* data;
+	std::size_t length;
+	std::size_t bit_count;
+	std::size_t released; ///< Length of the released prefix of the file in bytes.
+	std::size_t sampled_words; ///< Number of words included in the rank samples.
+	std::uint64_t sampled_ones; ///< Number of ones in the sampled words.
+	
+	MappedBitvector(char* data, std::size_t length, std::size_t bit_count)
+		: data(data),
+		  length(length),
+		  bit_count(bit_count),
+		  released(0),
+		  sampled_words(0),
+		  sampled_ones(0)
+	{ }
+	
+	static std::size_t sampleCount(std::size_t word_count) {
+		return (word_count + SampleWords - 1) / SampleWords + 1;
+	}
+	
+	static std::size_t fileLength(std::size_t n) {
+		std::size_t word_count = packedWordCount(n);
+		return 8 * (2 + word_count + sampleCount(word_count));
+	}
+	
+	/// Write bytes [begin, end) of the mapping to the file, where begin is at
+	/// a page boundary. Throws std::system_error if the write fails.
+	void sync(std::size_t begin, std::size_t end) {
+		if(end > begin && msync(data + begin, end - begin, MS_SYNC) == -1) {
+			throwSystemError("Writing bitvector file failed");
+		}
+	}
+	
+	std::size_t sampleCount() const {
+		return sampleCount(packedWordCount(bit_count));
+	}
+	
+	std::uint64_t* samples() {
+		return words() + packedWordCount(bit_count);
+	}
+	
+	const std::uint64_t* samples() const {
+		return words() + packedWordCount(bit_count);
+	}
+	
+	/// Check that the rank samples start from zero, increase by at most the
+	/// number of bits in a group and end with at most n ones.
+	bool validSamples() const {
+		const std::uint64_t* sample = samples();
+		std::size_t sample_count = sampleCount();
+		if(sample[0] != 0 || sample[sample_count - 1] > bit_count) return false;
+		for(std::size_t s = 1; s < sample_count; ++s) {
+			if(sample[s] < sample[s - 1] || sample[s] - sample[s - 1] > 64 * SampleWords) return false;
+		}
+		return true;
+	}
+};
+
+/// Write the n-bit packed bitvector given by function next_word() returning
+/// its words in order to a new bitvector file in given path, releasing the
+/// written part from memory after every release_words words. See
+/// MappedBitvector. Throws std::system_error if creating or writing the file
+/// fails.
+template <typename F>
+void writeBitvectorFile(
+	const std::string& path,
+	std::size_t n,
+	F next_word,
+	std::size_t release_words
+) {
+	MappedBitvector bitvector = MappedBitvector::create(path, n);
+	std::uint64_t* words = bitvector.words();
+	std::size_t word_count = packedWordCount(n);
+	
+	// The last call of release with w = word_count completes the file, also
+	// when the bitvector is empty.
+	std::size_t w = 0;
+	do {
+		std::size_t end = std::min(word_count, w + std::max(release_words, (std::size_t)1));
+		for(; w < end; ++w) {
+			words[w] = next_word();
+		}
+		bitvector.release(w);
+	} while(w < word_count);
+}
+
+/// Compute the same boolean vector as computeLessThanMatchTable to a new
+/// bitvector file in given path (see MappedBitvector), which can be larger
+/// than memory. The table is generated in order by
+/// LessThanMatchTableGenerator, which does not read back the earlier output,
+/// and the written part of the file is released from memory after every
+/// release_words words of output. Uses O(|Y|) bits of extra space.
+/// Throws std::system_error if creating or writing the file fails.
+template <typename XI, typename YI, typename Idx = std::size_t>
+void computeLessThanMatchTableToFile(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	const std::string& path,
+	std::size_t release_words = 1 << 20
+) {
+	LessThanMatchTableGenerator<XI, YI, Idx> gen(x_begin, x_end, y_begin, y_end);
+	writeBitvectorFile(
+		path, (std::size_t)(x_end - x_begin),
+		[&gen]() { return gen.next(); },
+		release_words
+	);
+}
+
+/// Compute the same boolean vector as computeRangeMatchTableToIterator to a
+/// new bitvector file in given path, as in computeLessThanMatchTableToFile.
+/// Uses O(|Y| + |Z|) bits of extra space.
+template <typename XI, typename YI, typename ZI, typename Idx = std::size_t>
+void computeRangeMatchTableToFile(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end,
+	const std::string& path,
+	std::size_t release_words = 1 << 20
+) {
+	LessThanMatchTableGenerator<XI, YI, Idx> y_gen(x_begin, x_end, y_begin, y_end);
+	LessThanMatchTableGenerator<XI, ZI, Idx> z_gen(x_begin, x_end, z_begin, z_end);
+	writeBitvectorFile(
+		path, (std::size_t)(x_end - x_begin),
+		[&y_gen, &z_gen]() { return z_gen.next() & ~y_gen.next(); },
+		release_words
+	);
+}
+
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "count.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Precomputed pattern state for counting string matches that can be stored
+// in binary form and loaded without recomputation.
+
+namespace srm {
+
+/// Self-contained counting workspace for a constant string Y of characters of
+/// type C, consisting of Y itself and the precomputed tables of a
+/// LessThanCounter for Y. The index lives in a binary blob that can be written
+/// to a file with serialize and used in place with load, for example directly
+/// from a MappedFile. Loading only copies the O(log |Y|) table entries to the
+/// counter; Y is referenced within the blob. The blob is specific to the
+/// character and index types and the byte order of the machine.
+template <typename C, typename Idx = std::size_t>
+class PatternIndex {
+public:
+	static_assert(std::is_trivially_copyable<C>::value, "C must be trivially copyable");
+	static_assert(alignof(C) <= 8 && alignof(Idx) <= 8, "Too large alignment");
+	
+	/// Type of the counter of the index.
+	typedef LessThanCounter<const C*, Idx> Counter;
+	
+	/// Construct the index for Y given by random-access iterator range
+	/// [y_begin, y_end), copying Y into a blob owned by the index. Parameter k
+	/// is the parameter of LessThanCounter (0 for automatic selection).
+	template <typename YI>
+	PatternIndex(YI y_begin, YI y_end, Idx k = 3)
+		: PatternIndex(build(y_begin, y_end, k))
+	{ }
+	
+	/// Load the index from the blob at the start of byte range
+	/// [data, data + size) written by serialize. The blob is used in place,
+	/// and therefore it must stay alive and unchanged throughout the lifetime
+	/// of the index. The data must be aligned to 8 bytes. The size of the blob
+	/// is returned by serializedSize, and is a multiple of 8 bytes, so that
+	/// blobs can be stored one after another. Throws std::runtime_error if
+	/// the data does not start with a valid blob.
+	static PatternIndex load(const char* data, std::size_t size) {
+		return PatternIndex(nullptr, data, size);
+	}
+	
+	/// Append the blob of the index to out.
+	void serialize(std::vector<char>& out) const {
+		out.insert(out.end(), data, data + header.size);
+	}
+	
+	/// Return the size of the blob of the index in bytes.
+	std::size_t serializedSize() const {
+		return (std::size_t)header.size;
+	}
+	
+	/// Return pointer to the first character of Y.
+	const C* begin() const {
+		return y_begin;
+	}
+	
+	/// Return pointer past the last character of Y.
+	const C* end() const {
+		return y_begin + header.m;
+	}
+	
+	/// Return the counter for Y.
+	const Counter& getCounter() const {
+		return counter;
+	}
+	
+	/// Return the count of suffixes of X lexicographically smaller than Y.
+	/// String X is given by random-access iterator range [x_begin, x_end).
+	template <typename XI>
+	Idx count(XI x_begin, XI x_end) const {
+		return counter.count(x_begin, x_end);
+	}
+	
+private:
+	/// Header at the start of the blob. It is followed by the Sp table
+	/// (sp_size values of type Idx), the Sn table (sn_size values of type Idx)
+	/// and Y (m values of type C, aligned for C), and padded to a multiple of
+	/// 8 bytes.
+	struct Header {
+		std::uint64_t magic;
+		std::uint64_t char_size;
+		std::uint64_t idx_size;
+		std::uint64_t size; ///< Total size of the blob in bytes.
+		std::uint64_t m;
+		std::uint64_t k;
+		std::uint64_t sp_size;
+		std::uint64_t sn_size;
+	};
+	
+	static const std::uint64_t magic_value = 0x3158444950524d53; // "SRMPIDX1"
+	
+	/// Owner of the blob, if it is owned by the index.
+	std::shared_ptr<const std::vector<std::uint64_t>> owner;
+	
+	const char* data;
+	Header header;
+	const C* y_begin;
+	Counter counter;
+	
+	explicit PatternIndex(std::shared_ptr<const std::vector<std::uint64_t>> owner)
+		: PatternIndex(owner, (const char*)owner->data(), 8 * owner->size())
+	{ }
+	
+	PatternIndex(
+		std::shared_ptr<const std::vector<std::uint64_t>> owner,
+		const char* data, std::size_t size
+	)
+		: owner(owner),
+		  data(data),
+		  header(readHeader(data, size)),
+		  y_begin((const C*)(data + yOffset(header))),
+		  counter(
+			y_begin, y_begin + header.m, (Idx)header.k,
+			(const Idx*)(data + sizeof(Header)), (std::size_t)header.sp_size,
+			(const Idx*)(data + snOffset(header)), (std::size_t)header.sn_size
+		  )
+	{ }
+	
+	static std::size_t alignUp(std::size_t x, std::size_t alignment) {
+		return (x + alignment - 1) / alignment * alignment;
+	}
+	
+	static std::size_t snOffset(const Header& header) {
+		return sizeof(Header) + sizeof(Idx) * header.sp_size;
+	}
+	
+	static std::size_t yOffset(const Header& header) {
+		return alignUp(snOffset(header) + sizeof(Idx) * header.sn_size, alignof(C));
+	}
+	
+	static std::size_t blobSize(const Header& header) {
+		return alignUp(yOffset(header) + sizeof(C) * header.m, 8);
+	}
+	
+	/// Read and validate the header of the blob at the start of
+	/// [data, data + size).
+	static Header readHeader(const char* data, std::size_t size) {
+		if((std::uintptr_t)data % 8 != 0) {
+			throw std::runtime_error("Pattern index blob is not aligned to 8 bytes");
+		}
+		
+		Header header;
+		if(size < sizeof(Header)) throw std::runtime_error("Pattern index blob is truncated");
+		std::memcpy(&header, data, sizeof(Header));
+		
+		if(
+			header.magic != magic_value ||
+			header.char_size != sizeof(C) ||
+			header.idx_size != sizeof(Idx)
+		) {
+			throw std::runtime_error("Pattern index blob has invalid format");
+		}
+		
+		// Check the sizes before computing the offsets so that the
+		// computations cannot overflow.
+		if(
+			header.size > size || header.m > size ||
+			header.sp_size > size || header.sn_size > size ||
+			header.sp_size % 3 != 0 || header.sn_size % 2 != 0 || header.sn_size == 0 ||
+			(header.k < 3) || header.k > (std::uint64_t)std::numeric_limits<Idx>::max() ||
+			blobSize(header) != header.size
+		) {
+			throw std::runtime_error("Pattern index blob is corrupted");
+		}
+		checkTables(data, header);
+		
+		return header;
+	}
+	
+	/// Validate the Sp and Sn tables of the blob at data with given valid
+	/// header, so that a corrupted blob cannot make the scans of the counter
+	/// jump by zero or past the precomputed range. In both tables, each b must
+	/// be nonzero, at most max(|Y|, 1) and at least two times the previous b,
+	/// and c must be at most b. The first element of Sn must be {1, 0}, and
+	/// the jumps b / 2 given by Sp must be nonzero.
+	static void checkTables(const char* data, const Header& header) {
+		const Idx* sp = (const Idx*)(data + sizeof(Header));
+		const Idx* sn = (const Idx*)(data + snOffset(header));
+		Idx max_b = (Idx)std::max(header.m, (std::uint64_t)1);
+		
+		auto check_b = [&](Idx b, Idx c, Idx prev_b) {
+			if(b == 0 || b > max_b || c > b || (prev_b != 0 && b / 2 < prev_b)) {
+				throw std::runtime_error("Pattern index blob is corrupted");
+			}
+		};
+		
+		Idx prev_b = 0;
+		for(std::size_t t = 0; t < header.sp_size; t += 3) {
+			if(sp[t] < 2) throw std::runtime_error("Pattern index blob is corrupted");
+			check_b(sp[t], sp[t + 2], prev_b);
+			prev_b = sp[t];
+		}
+		
+		if(sn[0] != 1 || sn[1] != 0) throw std::runtime_error("Pattern index blob is corrupted");
+		prev_b = 0;
+		for(std::size_t t = 0; t < header.sn_size; t += 2) {
+			check_b(sn[t], sn[t + 1], prev_b);
+			prev_b = sn[t];
+		}
+	}
+	
+	/// Copy Y given by random-access iterator range [y_begin, y_end) and the
+	/// tables of a LessThanCounter for it into a new blob.
+	template <typename YI>
+	static std::shared_ptr<const std::vector<std::uint64_t>> build(
+		YI y_begin, YI y_end, Idx k
+	) {
+		std::vector<C> Y(y_begin, y_end);
+		Counter counter(Y.data(), Y.data() + Y.size(), k);
+		std::vector<Idx> sp = counter.getSpTable();
+		std::vector<Idx> sn = counter.getSnTable();
+		
+		Header header;
+		header.magic = magic_value;
+		header.char_size = sizeof(C);
+		header.idx_size = sizeof(Idx);
+		header.m = Y.size();
+		header.k = counter.getK();
+		header.sp_size = sp.size();
+		header.sn_size = sn.size();
+		header.size = blobSize(header);
+		
+		std::shared_ptr<std::vector<std::uint64_t>> blob =
+			std::make_shared<std::vector<std::uint64_t>>(header.size / 8, 0);
+		char* out = (char*)blob->data();
+		std::memcpy(out, &header, sizeof(Header));
+		std::copy(sp.begin(), sp.end(), (Idx*)(out + sizeof(Header)));
+		std::copy(sn.begin(), sn.end(), (Idx*)(out + snOffset(header)));
+		std::copy(Y.begin(), Y.end(), (C*)(out + yOffset(header)));
+		
+		return blob;
+	}
+};
+
+/// Load all the pattern indices from consecutive blobs in byte range
+/// [data, data + size), as written by calling PatternIndex::serialize for
+/// each index. See PatternIndex::load for details.
+template <typename C, typename Idx = std::size_t>
+std::vector<PatternIndex<C, Idx>> loadPatternIndices(const char* data, std::size_t size) {
+	std::vector<PatternIndex<C, Idx>> ret;
+	std::size_t pos = 0;
+	while(pos < size) {
+		ret.push_back(PatternIndex<C, Idx>::load(data + pos, size - pos));
+		pos += ret.back().serializedSize();
+	}
+	return ret;
+}
+
+}
@@ -4,19 +4,252 @@
 #include "crochermore.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <cassert>
 #include <algorithm>
 #include <type_traits>
+#include <vector>
 
 // Algorithm for creating listing string range matches.
 
 namespace srm {
 
+/// Output function for the reporting algorithms that only counts the matches
+/// to count. Runs of matches are counted in constant time.
+template <typename Idx = std::size_t>
+struct MatchCountOutput {
+	typedef void RunOutputTag;
+	
+	Idx& count;
+	
+	void operator()(Idx) {
+		++count;
+	}
+	
+	void operator()(Idx, Idx, Idx run_count) {
+		count += run_count;
+	}
+};
+
+/// Output function for the reporting algorithms that collects the matches to
+/// a fixed-size buffer of N indices stored in the object, and passes them to
+/// function consumer(const Idx* begin, const Idx* end) a full buffer at a
+/// time, avoiding the overhead of calling an opaque function for each match.
+/// The remaining matches are passed to consumer by flush, which must be
+/// called after the reporting. The object must not be copied during the
+/// reporting, so it should be passed to the reporting algorithms by
+/// reference, see reportRangeMatchSpans.
+template <typename F, typename Idx = std::size_t, std::size_t N = 1024>
+class SpanOutput {
+public:
+	typedef void RunOutputTag;
+	
+	explicit SpanOutput(F consumer)
+		: consumer(consumer),
+		  count(0)
+	{ }
+	
+	void operator()(Idx i) {
+		if(count == N) flush();
+		buffer[count++] = i;
+	}
+	
+	void operator()(Idx start, Idx step, Idx run_count) {
+		while(run_count != 0) {
+			if(count == N) flush();
+			std::size_t t = std::min((std::size_t)run_count, N - count);
+			for(std::size_t j = 0; j < t; ++j) {
+				buffer[count++] = start;
+				start += step;
+			}
+			run_count -= (Idx)t;
+		}
+	}
+	
+	/// Pass the buffered matches to consumer and empty the buffer.
+	void flush() {
+		if(count != 0) consumer((const Idx*)buffer, (const Idx*)buffer + count);
+		count = 0;
+	}
+	
+private:
+	F consumer;
+	Idx buffer[N];
+	std::size_t count;
+};
+
+/// Consumer for SpanOutput that appends the matches to preallocated array
+/// data of integers of type T, such as std::uint32_t or std::uint64_t. The
+/// current number of elements in the array is size, which is updated by the
+/// consumer; as it is referenced, copies of the consumer share it. The array
+/// must have room for all the matches, for example |X| + 1 elements or the
+/// number of matches given by a counting algorithm.
+template <typename T>
+struct ArraySink {
+	T* data;
+	std::size_t& size;
+	
+	template <typename Idx>
+	void operator()(const Idx* begin, const Idx* end) {
+		T* out = data + size;
+		for(const Idx* i = begin; i != end; ++i) {
+			*out++ = (T)*i;
+		}
+		size += (std::size_t)(end - begin);
+	}
+};
+
+/// Precomputed values for one level [Y[0..r), Y(0..m)) of the restricted range
+/// matching algorithm used by reportRestrictedRangeMatches. The values depend
+/// only on Y.
+template <typename Idx>
+struct RestrictedLevel {
+	Idx r; ///< Length of the prefix of Y starting the level.
+	Idx m; ///< Length of the prefix of Y ending the level.
+	Idx q; ///< Period of Y[0..r).
+	Idx e; ///< Length of the longest prefix of Y[0..m) with period q.
+	
+	/// True if the occurrences of Y[0..r) inside a run of period q extending
+	/// far enough are matches.
+	bool extend;
+};
+
+/// Compute the values of the level of reportRestrictedRangeMatches starting
+/// from prefix of length r of Y given by random-access iterator range
+/// [y_begin, y_end).
+template <typename YI, typename Idx = std::size_t>
+RestrictedLevel<Idx> computeRestrictedLevel(
+	YI y_begin, YI y_end,
+	Idx r,
+	bool less_than
+) {
+	// Convenience function to index Y.
+	auto Y = [y_begin](Idx i) { return *(y_begin + i); };
+	Idx M = (Idx)(y_end - y_begin);
+	
+	Idx m = std::min(r + r / 2 + 1, M);
+	
+	Idx q = computeStringPeriod<YI, Idx>(y_begin, y_begin + r);
+	Idx e = 0;
+	while(q + e < m && Y(e) == Y(q + e)) ++e;
+	e += q;
+	
+	bool extend = e < m && (less_than ? Y(e) < Y(e % q) : Y(e) >= Y(e % q));
+	
+	return RestrictedLevel<Idx>{r, m, q, e, extend};
+}
+
+/// State of a scan reporting the matches in one level of
+/// reportRestrictedRangeMatches, advanced by function scanRestrictedLevel.
+template <typename Idx>
+struct RestrictedLevelScanState {
+	Idx i; ///< Starting index of the next suffix to process.
+	MSTuple<Idx> ms; ///< Maximal suffix of the known match of Y at i.
+};
+
+/// Return the scan state for starting a scan of a restricted level.
+template <typename Idx>
+RestrictedLevelScanState<Idx> startRestrictedLevelScan() {
+	return RestrictedLevelScanState<Idx>{0, MSTuple<Idx>{0, 0, 0}};
+}
+
+/// Advance the scan state of reporting the matches of string X given by
+/// random-access iterator range [x_begin, x_end) in one level of
+/// reportRestrictedRangeMatches for Y given by random-access iterator range
+/// [y_begin, y_end) until state.i >= end. The scan is complete when
+/// state.i >= |X|.
+template <typename XI, typename YI, typename F, typename Idx = std::size_t>
+void scanRestrictedLevel(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	const RestrictedLevel<Idx>& level,
+	RestrictedLevelScanState<Idx>& state, Idx end,
+	F& output,
+	bool less_than
+) {
+	// Convenience functions to index X and Y.
+	auto X = [x_begin](Idx i) { return *(x_begin + i); };
+	auto Y = [y_begin](Idx i) { return *(y_begin + i); };
+	Idx n = (Idx)(x_end - x_begin);
+	Idx M = (Idx)(y_end - y_begin);
+	
+	Idx r = level.r;
+	Idx m = level.m;
+	Idx q = level.q;
+	Idx e = level.e;
+	
+	Idx i = state.i;
+	MSTuple<Idx> ms = state.ms;
+	
+	end = std::min(end, n);
+	while(i < end) {
+		while(i + ms.l < n && ms.l < m && X(i + ms.l) == Y(ms.l)) {
+			ms = updateMS<decltype(Y), Idx>(Y, ms);
+		}
+		
+		if(less_than) {
+			if(ms.l >= r && ms.l < m && (i + ms.l == n || X(i + ms.l) < Y(ms.l))) {
+				output(i);
+			}
+		} else {
+			if(ms.l >= r && ms.l == m && m == M) {
+				output(i);
+			}
+			if(ms.l >= r && ms.l < m && i + ms.l != n && X(i + ms.l) >= Y(ms.l)) {
+				output(i);
+			}
+		}
+		
+		Idx h;
+		if(
+			ms.p > 0 && ms.p <= ms.l / 3 &&
+			std::equal(y_begin, y_begin + ms.s, y_begin + ms.p)
+		) {
+			h = ms.p;
+			ms.l -= ms.p;
+		} else {
+			h = ms.l / 3 + 1;
+			ms = MSTuple<Idx>{0, 0, 0};
+		}
+		
+		if(level.extend) {
+			Idx g = std::min(h - 1, e - r) / q;
+			outputRun<Idx>(output, i + q, q, g);
+		}
+		
+		i += h;
+	}
+	
+	state = RestrictedLevelScanState<Idx>{i, ms};
+}
+
+/// Report the matches of string X given by random-access iterator range
+/// [x_begin, x_end) in one level of reportRestrictedRangeMatches for Y given by
+/// random-access iterator range [y_begin, y_end).
+template <typename XI, typename YI, typename F, typename Idx = std::size_t>
+void reportRestrictedLevelMatches(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	const RestrictedLevel<Idx>& level,
+	F& output,
+	bool less_than
+) {
+	RestrictedLevelScanState<Idx> state = startRestrictedLevelScan<Idx>();
+	scanRestrictedLevel<XI, YI, F, Idx>(
+		x_begin, x_end, y_begin, y_end,
+		level, state, (Idx)(x_end - x_begin),
+		output, less_than
+	);
+}
+
 /// Given strings X and Y, finds the suffixes of X that are lexicographically
 /// less than Y and have Y' as prefix, where Y' is a prefix of Y. Strings X, Y
 /// and Y' are given as random-access iterator ranges [x_begin, x_end),
 /// [y_begin, y_end) and [y_begin, yp_end). The starting indices of the matches
 /// in X are passed to function output. The output indices are not in order but
-/// are unique.
+/// are unique. If the type of output defines the member type RunOutputTag, the
+/// matches inside periodic runs are passed as output(start, step, count) as
+/// arithmetic progressions start, start + step, ..., start + (count - 1) * step.
 ///
 /// To output the suffixes that are greater than or equal to Y, set less_than
 /// to false.
@@ -41,10 +274,6 @@ void reportRestrictedRangeMatches(
 	F output,
 	bool less_than = true
 ) {
-	// Convenience functions to index X and Y.
-	auto X = [x_begin](Idx i) { return *(x_begin + i); };
-	auto Y = [y_begin](Idx i) { return *(y_begin + i); };
-	Idx n = (Idx)(x_end - x_begin);
 	Idx M = (Idx)(y_end - y_begin);
 	Idx R = (Idx)(yp_end - y_begin);
 	
@@ -52,62 +281,147 @@ void reportRestrictedRangeMatches(
 	// where r >= floor(2m/3).
 	Idx r = R;
 	while(true) {
-		Idx m = std::min(r + r / 2 + 1, M);
+		RestrictedLevel<Idx> level =
+			computeRestrictedLevel<YI, Idx>(y_begin, y_end, r, less_than);
+		reportRestrictedLevelMatches<XI, YI, F, Idx>(
+			x_begin, x_end, y_begin, y_end, level, output, less_than
+		);
 		
-		Idx i = 0;
-		MSTuple<Idx> ms{0, 0, 0};
+		if(level.m == M) break;
 		
-		Idx q = computeStringPeriod(y_begin, y_begin + r);
-		Idx e = 0;
-		while(q + e < m && Y(e) == Y(q + e)) ++e;
-		e += q;
+		r = level.m;
+	}
+}
+
+/// Compute the levels of reportRestrictedRangeMatches for Y and Y' given by
+/// random-access iterator ranges [y_begin, y_end) and [y_begin, yp_end).
+template <typename YI, typename Idx = std::size_t>
+std::vector<RestrictedLevel<Idx>> computeRestrictedLevels(
+	YI y_begin, YI y_end, YI yp_end,
+	bool less_than
+) {
+	Idx M = (Idx)(y_end - y_begin);
+	
+	std::vector<RestrictedLevel<Idx>> levels;
+	Idx r = (Idx)(yp_end - y_begin);
+	while(true) {
+		levels.push_back(computeRestrictedLevel<YI, Idx>(y_begin, y_end, r, less_than));
+		if(levels.back().m == M) break;
+		r = levels.back().m;
+	}
+	return levels;
+}
+
+/// Advance the scan states of all the given levels of
+/// reportRestrictedRangeMatches until index end. See scanRestrictedLevel for
+/// details.
+template <typename XI, typename YI, typename F, typename Idx = std::size_t>
+void scanRestrictedLevels(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	const std::vector<RestrictedLevel<Idx>>& levels,
+	std::vector<RestrictedLevelScanState<Idx>>& states, Idx end,
+	F& output,
+	bool less_than
+) {
+	for(std::size_t j = 0; j < levels.size(); ++j) {
+		scanRestrictedLevel<XI, YI, F, Idx>(
+			x_begin, x_end, y_begin, y_end,
+			levels[j], states[j], end,
+			output, less_than
+		);
+	}
+}
+
+/// Same as reportRestrictedRangeMatches, but instead of passing over X once
+/// for each level, X is processed in blocks of scanBlockSize() characters
+/// and all the levels are advanced over a block while it is in cache, so
+/// that X is streamed from memory only once. The scans of the levels carry
+/// over from block to block, so that matches starting near the end of a
+/// block are found while reading characters past it.
+/// Uses O(log(|Y| / |Y'|)) space for the levels.
+template <
+	typename XI, typename YI,
+	typename F,
+	typename Idx = std::size_t
+>
+void reportRestrictedRangeMatchesBlocked(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end, YI yp_end,
+	F output,
+	bool less_than = true
+) {
+	Idx n = (Idx)(x_end - x_begin);
+	
+	std::vector<RestrictedLevel<Idx>> levels =
+		computeRestrictedLevels<YI, Idx>(y_begin, y_end, yp_end, less_than);
+	std::vector<RestrictedLevelScanState<Idx>> states(
+		levels.size(), startRestrictedLevelScan<Idx>()
+	);
+	
+	Idx pos = 0;
+	while(pos < n) {
+		pos += std::min((Idx)scanBlockSize(), n - pos);
+		scanRestrictedLevels<XI, YI, F, Idx>(
+			x_begin, x_end, y_begin, y_end,
+			levels, states, pos,
+			output, less_than
+		);
+	}
+}
+
+/// Filter for the occurrences of the LCP of strings Y and Z in string X that
+/// passes to function output the occurrences starting suffixes of X
+/// lexicographically in range [Y, Z). String X is given by random-access
+/// iterator range [x_begin, x_end), and yi and zi point to the characters of Y
+/// and Z after their LCP, whose length is lcp.
+template <typename XI, typename YI, typename ZI, typename F, typename Idx>
+struct CommonPrefixRangeFilter {
+	XI x_begin;
+	XI x_end;
+	YI yi;
+	YI y_end;
+	ZI zi;
+	ZI z_end;
+	Idx lcp;
+	F& output;
+	
+	void operator()(Idx pos) const {
+		if(x_begin + pos == x_end) return;
 		
-		while(i < n) {
-			while(i + ms.l < n && ms.l < m && X(i + ms.l) == Y(ms.l)) {
-				ms = updateMS<decltype(Y), Idx>(Y, ms);
-			}
-			
-			if(less_than) {
-				if(ms.l >= r && ms.l < m && (i + ms.l == n || X(i + ms.l) < Y(ms.l))) {
-					output(i);
-				}
-			} else {
-				if(ms.l >= r && ms.l == m && m == M) {
-					output(i);
-				}
-				if(ms.l >= r && ms.l < m && i + ms.l != n && X(i + ms.l) >= Y(ms.l)) {
-					output(i);
-				}
-			}
-			
-			Idx h;
-			if(
-				ms.p > 0 && ms.p <= ms.l / 3 &&
-				std::equal(y_begin, y_begin + ms.s, y_begin + ms.p)
-			) {
-				h = ms.p;
-				ms.l -= ms.p;
-			} else {
-				h = ms.l / 3 + 1;
-				ms = MSTuple<Idx>{0, 0, 0};
-			}
-			
-			if(e < m && less_than ? Y(e) < Y(e % q) : Y(e) >= Y(e % q)) {
-				Idx g = std::min(h - 1, e - r) / q;
-				Idx x = i;
-				for(Idx t = 0; t < g; ++t) {
-					x += q;
-					output(x);
-				}
-			}
-			
-			i += h;
+		XI xi = x_begin + pos + lcp;
+		if(xi == x_end) {
+			if(yi == y_end && zi != z_end) output(pos);
+			return;
 		}
 		
-		if(m == M) break;
+		if(zi == z_end || !(*xi < *zi)) return;
+		if(yi != y_end && !(*yi < *xi)) return;
 		
-		r = m;
+		output(pos);
 	}
+};
+
+/// Report the suffixes of string X given by random-access iterator range
+/// [x_begin, x_end) that are lexicographically in range [Y, Z) and have
+/// LCP(Y, Z) characters in common with both Y and Z. Strings Y and Z are given
+/// by random-access iterator ranges [y_begin, y_end) and [z_begin, z_end), and
+/// yi and zi point to the characters of Y and Z after their LCP.
+template <typename XI, typename YI, typename ZI, typename F, typename Idx = std::size_t>
+void reportCommonPrefixRangeMatches(
+	XI x_begin, XI x_end,
+	YI y_begin, YI yi, YI y_end,
+	ZI zi, ZI z_end,
+	F& output
+) {
+	typedef CommonPrefixRangeFilter<XI, YI, ZI, F, Idx> Filter;
+	Filter exact_filter{x_begin, x_end, yi, y_end, zi, z_end, (Idx)(yi - y_begin), output};
+	
+	reportExactStringMatches<YI, XI, Filter, Idx>(
+		y_begin, yi,
+		x_begin, x_end,
+		exact_filter
+	);
 }
 
 /// Given strings X, Y and Z, finds the suffixes of X that are lexicographically
@@ -115,6 +429,8 @@ void reportRestrictedRangeMatches(
 /// [x_begin, x_end), [y_begin, y_end) and [z_begin, z_end). The starting indices
 /// of the matches in X are passed to function output. The output indices are not
 /// in order but are unique. String Y is assumed to be lexicographically at most Z.
+/// Runs of matches can be passed to output as arithmetic progressions, see
+/// reportRestrictedRangeMatches.
 /// 
 /// The characters should be comparable with operators < and ==.
 /// Integer type Idx should be large enough to hold two times the sizes of
@@ -125,7 +441,8 @@ void reportRestrictedRangeMatches(
 /// J. Kärkkäinen, D. Kempa, S. Puglisi: String Range Matching. 2014.
 ///
 /// The algorithm runs in O(|X| log((|Y| + |Z|) / (lcp(Y, Z) + 1))) time and uses
-/// constant space.
+/// constant space. It passes over X once for each level of the algorithm;
+/// RangeReporter passes over X only once using O(log(|Y| + |Z|)) space.
 template <typename XI, typename YI, typename ZI, typename F, typename Idx = std::size_t>
 void reportRangeMatches(
 	XI x_begin, XI x_end,
@@ -136,17 +453,18 @@ void reportRangeMatches(
 	// Compute the LCP of Y and Z.
 	YI yi = y_begin;
 	ZI zi = z_begin;
-	Idx lcp = 0;
 	
 	while(yi != y_end && zi != z_end && *yi == *zi) {
 		++yi;
 		++zi;
-		++lcp;
 	}
 	
+	// The same output function is passed by reference to all the parts so
+	// that stateful output functions see all the matches.
+	
 	// Add suffixes with LCP(suffix, Y) > LCP(Y, Z).
 	if(zi != z_end) {
-		reportRestrictedRangeMatches<XI, ZI, F, Idx>(
+		reportRestrictedRangeMatches<XI, ZI, F&, Idx>(
 			x_begin, x_end,
 			z_begin, z_end, zi + 1,
 			output,
@@ -156,7 +474,7 @@ void reportRangeMatches(
 	
 	// Add suffixes with LCP(suffix, Z) > LCP(Y, Z).
 	if(yi != y_end) {
-		reportRestrictedRangeMatches<XI, YI, F, Idx>(
+		reportRestrictedRangeMatches<XI, YI, F&, Idx>(
 			x_begin, x_end,
 			y_begin, y_end, yi + 1,
 			output,
@@ -165,26 +483,347 @@ void reportRangeMatches(
 	}
 	
 	// Add sets with Y <= suffix < Z with LCP(suffix, Y) = LCP(suffix, Z) = LCP(Y, Z).
-	auto exact_filter = [&](Idx pos) {
-		if(x_begin + pos == x_end) return;
+	reportCommonPrefixRangeMatches<XI, YI, ZI, F&, Idx>(
+		x_begin, x_end,
+		y_begin, yi, y_end,
+		zi, z_end,
+		output
+	);
+}
+
+/// Equivalent to reportRangeMatches, but the matches are passed to function
+/// consumer(const Idx* begin, const Idx* end) in spans of up to 1024 indices,
+/// buffered by SpanOutput. ArraySink can be used as consumer to write the
+/// matches to a preallocated array.
+template <typename XI, typename YI, typename ZI, typename F, typename Idx = std::size_t>
+void reportRangeMatchSpans(
+	XI x_begin, XI x_end,
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end,
+	F consumer
+) {
+	SpanOutput<F, Idx> output(consumer);
+	reportRangeMatches<XI, YI, ZI, SpanOutput<F, Idx>&, Idx>(
+		x_begin, x_end,
+		y_begin, y_end,
+		z_begin, z_end,
+		output
+	);
+	output.flush();
+}
+
+template <typename XI, typename YI, typename ZI, typename Idx>
+class RangeMatchCursor;
+
+/// Output function for the reporting algorithms that collects matches to a
+/// bitmap, so that they can be passed on in increasing order. The bitmap
+/// covers the positions from base, which is a multiple of 64, up to
+/// base + step + overlap + 64, where the scans are advanced by at most step
+/// positions at a time and report matches at most overlap positions beyond
+/// the end of the scan, see RangeReporter::scan.
+template <typename Idx = std::size_t>
+class SortedMatchBuffer {
+public:
+	SortedMatchBuffer(Idx step, Idx overlap)
+		: bitmap((step + overlap) / 64 + 2, 0),
+		  base(0)
+	{ }
+	
+	void operator()(Idx i) {
+		assert(i >= base && (i - base) / 64 < bitmap.size());
+		bitmap[(i - base) / 64] |= (std::uint64_t)1 << ((i - base) % 64);
+	}
+	
+	/// Pass the collected matches before pos to function output in increasing
+	/// order and remove them from the buffer.
+	template <typename F>
+	void flush(Idx pos, F& output) {
+		std::size_t shift = std::min((std::size_t)((pos - base) / 64), bitmap.size());
+		for(std::size_t w = 0; w <= shift && w < bitmap.size(); ++w) {
+			std::uint64_t word = bitmap[w];
+			if(w == shift) {
+				word &= ((std::uint64_t)1 << ((pos - base) % 64)) - 1;
+				bitmap[w] ^= word;
+			}
+			while(word != 0) {
+				output(base + (Idx)(64 * w + floorLog2(word & (~word + 1))));
+				word &= word - 1;
+			}
+		}
 		
-		XI xi = x_begin + pos + lcp;
-		if(xi == x_end) {
-			if(yi == y_end && zi != z_end) output(pos);
-			return;
+		// Move the rest of the bitmap to the front.
+		std::copy(bitmap.begin() + shift, bitmap.end(), bitmap.begin());
+		std::fill(bitmap.end() - shift, bitmap.end(), 0);
+		base += (Idx)(64 * shift);
+	}
+	
+private:
+	std::vector<std::uint64_t> bitmap;
+	Idx base;
+};
+
+/// Workspace for reporting the suffixes of string X that are lexicographically
+/// in range [Y, Z) for constant strings Y and Z. Equivalent to
+/// reportRangeMatches, but the values that depend only on Y and Z (their LCP
+/// and the periods of the levels of the restricted range matching) are
+/// precomputed, so that reporting in many strings X only does the work that
+/// depends on X. Strings Y and Z must stay constant throughout the lifetime of
+/// the workspace. The workspace uses O(log(|Y| + |Z|)) space.
+/// See the documentation of reportRangeMatches for more details.
+template <typename YI, typename ZI, typename Idx = std::size_t>
+class RangeReporter {
+public:
+	/// Construct the workspace for Y and Z given by random-access iterator
+	/// ranges [y_begin, y_end) and [z_begin, z_end).
+	RangeReporter(YI y_begin, YI y_end, ZI z_begin, ZI z_end)
+		: y_begin(y_begin),
+		  y_end(y_end),
+		  z_begin(z_begin),
+		  z_end(z_end)
+	{
+		// Compute the LCP of Y and Z.
+		yi = y_begin;
+		zi = z_begin;
+		while(yi != y_end && zi != z_end && *yi == *zi) {
+			++yi;
+			++zi;
 		}
 		
-		if(zi == z_end || !(*xi < *zi)) return;
-		if(yi != y_end && !(*yi < *xi)) return;
+		if(zi != z_end) {
+			z_levels = computeRestrictedLevels<ZI, Idx>(z_begin, z_end, zi + 1, true);
+		}
+		if(yi != y_end) {
+			y_levels = computeRestrictedLevels<YI, Idx>(y_begin, y_end, yi + 1, false);
+		}
+	}
+	
+	/// Find the suffixes of X lexicographically in range [Y, Z). String X is
+	/// given by random-access iterator range [x_begin, x_end). The starting
+	/// indices of the matches in X are passed to function output. The output
+	/// indices are not in order but are unique; see reportSorted for ordered
+	/// output. Runs of matches can be passed to output as arithmetic
+	/// progressions, see reportRestrictedRangeMatches.
+	///
+	/// Instead of passing over X separately for each level and for the exact
+	/// matches of the LCP, all the scans are advanced over a block of X at a
+	/// time while it is in cache, so that X is streamed from memory only once.
+	template <typename XI, typename F>
+	void report(XI x_begin, XI x_end, F output) const {
+		Idx n = (Idx)(x_end - x_begin);
+		ScanState state = startScan();
+		while(state.pos <= n) {
+			scan<XI, F>(x_begin, x_end, state, state.pos + (Idx)scanBlockSize(), output);
+		}
+	}
+	
+	/// Equivalent to report, but the matches are passed to function output in
+	/// increasing order. The matches are collected to a SortedMatchBuffer for
+	/// the reporter and passed to output in order after each block of X, using
+	/// O(scanBlockSize() + |Y| + |Z|) extra bits.
+	template <typename XI, typename F>
+	void reportSorted(XI x_begin, XI x_end, F output) const {
+		Idx n = (Idx)(x_end - x_begin);
+		SortedMatchBuffer<Idx> buffer(scanBlockSize(), maxSkip());
+		ScanState state = startScan();
+		while(state.pos <= n) {
+			scan<XI, SortedMatchBuffer<Idx>>(
+				x_begin, x_end, state, state.pos + (Idx)scanBlockSize(), buffer
+			);
+			buffer.flush(state.pos, output);
+		}
+	}
+	
+	/// Equivalent to report, but the matches are passed to function
+	/// consumer(const Idx* begin, const Idx* end) in spans, as in
+	/// reportRangeMatchSpans.
+	template <typename XI, typename F>
+	void reportSpans(XI x_begin, XI x_end, F consumer) const {
+		SpanOutput<F, Idx> output(consumer);
+		report<XI, SpanOutput<F, Idx>&>(x_begin, x_end, output);
+		output.flush();
+	}
+	
+	/// State of the scans of report over a string X, advanced by function
+	/// scan.
+	struct ScanState {
+		/// Position up to which all the matches have been reported.
+		Idx pos;
 		
-		output(pos);
+		/// States of the scans of the levels for Z and Y.
+		std::vector<RestrictedLevelScanState<Idx>> z_states;
+		std::vector<RestrictedLevelScanState<Idx>> y_states;
+		
+		/// State of the scan of the exact matches of the LCP of Y and Z.
+		ExactMatchScanState<Idx> exact_state;
 	};
 	
-	reportExactStringMatches<YI, XI, decltype(exact_filter), Idx>(
-		y_begin, yi,
-		x_begin, x_end,
-		exact_filter
-	);
+	/// Return the scan state for starting the scans at the beginning of X.
+	ScanState startScan() const {
+		return ScanState{
+			0,
+			std::vector<RestrictedLevelScanState<Idx>>(
+				z_levels.size(), startRestrictedLevelScan<Idx>()
+			),
+			std::vector<RestrictedLevelScanState<Idx>>(
+				y_levels.size(), startRestrictedLevelScan<Idx>()
+			),
+			startExactMatchScan<Idx>()
+		};
+	}
+	
+	/// Advance the scan state of reporting the matches in X given by
+	/// random-access iterator range [x_begin, x_end) until state.pos >= end,
+	/// passing the matches to function output. Afterwards, all the matches
+	/// before state.pos have been reported, and the matches reported by this
+	/// call are at least the previous state.pos and less than
+	/// state.pos + maxSkip(). The scan is complete when state.pos > |X|.
+	template <typename XI, typename F>
+	void scan(XI x_begin, XI x_end, ScanState& state, Idx end, F& output) const {
+		Idx n = (Idx)(x_end - x_begin);
+		end = std::min(end, n + 1);
+		
+		// Add suffixes with LCP(suffix, Y) > LCP(Y, Z).
+		scanRestrictedLevels<XI, ZI, F, Idx>(
+			x_begin, x_end, z_begin, z_end,
+			z_levels, state.z_states, end,
+			output, true
+		);
+		
+		// Add suffixes with LCP(suffix, Z) > LCP(Y, Z).
+		scanRestrictedLevels<XI, YI, F, Idx>(
+			x_begin, x_end, y_begin, y_end,
+			y_levels, state.y_states, end,
+			output, false
+		);
+		
+		// Sets with Y <= suffix < Z with LCP(suffix, Y) = LCP(suffix, Z) = LCP(Y, Z)
+		// are found as exact matches of the LCP, including the empty suffix.
+		typedef CommonPrefixRangeFilter<XI, YI, ZI, F, Idx> Filter;
+		Filter exact_filter{x_begin, x_end, yi, y_end, zi, z_end, (Idx)(yi - y_begin), output};
+		scanExactStringMatches<YI, XI, Filter, Idx>(
+			y_begin, yi, x_begin, x_end, state.exact_state, end, exact_filter
+		);
+		
+		state.pos = std::max(state.pos, end);
+	}
+	
+	/// Return the bound of how far beyond the end of a scan the matches can be
+	/// reported, max(|Y|, |Z|) / 3 + 1, which bounds the skip of a restricted
+	/// level scan.
+	Idx maxSkip() const {
+		return (Idx)std::max(y_end - y_begin, z_end - z_begin) / 3 + 1;
+	}
+	
+	/// Return the number of matches in X given by random-access iterator
+	/// range [x_begin, x_end), up to limit. The first matches, at most limit,
+	/// are passed to function output in increasing order. The scan stops as
+	/// soon as limit matches are found.
+	template <typename XI, typename F>
+	Idx reportFirst(XI x_begin, XI x_end, Idx limit, F output) const {
+		RangeMatchCursor<XI, YI, ZI, Idx> cursor(*this, x_begin, x_end);
+		Idx count = 0;
+		Idx i;
+		while(count < limit && cursor.next(i)) {
+			output(i);
+			++count;
+		}
+		return count;
+	}
+	
+	/// Return true if X given by random-access iterator range
+	/// [x_begin, x_end) has a suffix in range [Y, Z). The scan stops at the
+	/// first match found.
+	template <typename XI>
+	bool exists(XI x_begin, XI x_end) const {
+		Idx i;
+		return RangeMatchCursor<XI, YI, ZI, Idx>(*this, x_begin, x_end).next(i);
+	}
+	
+private:
+	YI y_begin;
+	YI y_end;
+	ZI z_begin;
+	ZI z_end;
+	YI yi; ///< Position after the LCP of Y and Z in Y.
+	ZI zi; ///< Position after the LCP of Y and Z in Z.
+	
+	/// Levels of the restricted range matching for Z and Y.
+	std::vector<RestrictedLevel<Idx>> z_levels;
+	std::vector<RestrictedLevel<Idx>> y_levels;
+};
+
+/// Equivalent to constructor of RangeReporter of appropriate type.
+template <typename YI, typename ZI, typename Idx = std::size_t>
+RangeReporter<YI, ZI, Idx> makeRangeReporter(
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end
+) {
+	return RangeReporter<YI, ZI, Idx>(y_begin, y_end, z_begin, z_end);
+}
+
+/// Lazy pull-based iteration over the suffixes of string X that are
+/// lexicographically in range [Y, Z), in increasing order of position. The
+/// scans of a RangeReporter are advanced only when more matches are needed,
+/// first over short steps of X, doubling the step up to scanBlockSize(), so
+/// that finding the first matches only scans a prefix of X slightly longer
+/// than needed. The reporter and X must stay alive and unchanged throughout the
+/// lifetime of the cursor.
+template <typename XI, typename YI, typename ZI, typename Idx = std::size_t>
+class RangeMatchCursor {
+public:
+	/// Start iterating the matches in X given by random-access iterator range
+	/// [x_begin, x_end) for reporter.
+	RangeMatchCursor(const RangeReporter<YI, ZI, Idx>& reporter, XI x_begin, XI x_end)
+		: reporter(reporter),
+		  x_begin(x_begin),
+		  x_end(x_end),
+		  state(reporter.startScan()),
+		  step(256),
+		  buffer((Idx)scanBlockSize(), reporter.maxSkip()),
+		  ready_pos(0)
+	{ }
+	
+	/// Store the next match to i and return true, or return false if there
+	/// are no more matches.
+	bool next(Idx& i) {
+		Idx n = (Idx)(x_end - x_begin);
+		while(ready_pos == ready.size()) {
+			if(state.pos > n) return false;
+			
+			reporter.template scan<XI, SortedMatchBuffer<Idx>>(
+				x_begin, x_end, state, state.pos + step, buffer
+			);
+			step = std::min(2 * step, (Idx)scanBlockSize());
+			
+			ready.clear();
+			ready_pos = 0;
+			auto push = [this](Idx j) { ready.push_back(j); };
+			buffer.flush(state.pos, push);
+		}
+		i = ready[ready_pos++];
+		return true;
+	}
+	
+private:
+	const RangeReporter<YI, ZI, Idx>& reporter;
+	XI x_begin;
+	XI x_end;
+	typename RangeReporter<YI, ZI, Idx>::ScanState state;
+	Idx step; ///< Length of the next step of the scans.
+	SortedMatchBuffer<Idx> buffer;
+	
+	/// Matches found in the last step, returned from index ready_pos onwards.
+	std::vector<Idx> ready;
+	std::size_t ready_pos;
+};
+
+/// Equivalent to constructor of RangeMatchCursor of appropriate type.
+template <typename XI, typename YI, typename ZI, typename Idx>
+RangeMatchCursor<XI, YI, ZI, Idx> makeRangeMatchCursor(
+	const RangeReporter<YI, ZI, Idx>& reporter,
+	XI x_begin, XI x_end
+) {
+	return RangeMatchCursor<XI, YI, ZI, Idx>(reporter, x_begin, x_end);
 }
 
 }
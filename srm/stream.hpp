@@ -0,0 +1,179 @@
+#pragma once
+
+#include "count.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+// Algorithms for counting string range matches in text given as a stream.
+
+namespace srm {
+
+/// Same as LessThanCounter, but instead of requiring random access to the
+/// whole string X, X is given in arbitrary-sized chunks of characters of type
+/// C using function feed, and the count is obtained using function count or,
+/// in the end, finish. Only a window of less than 2 |Y| characters of X is
+/// kept in memory between calls.
+/// See the documentation of LessThanCounter for more details.
+template <
+	typename YI,
+	typename C = typename std::iterator_traits<YI>::value_type,
+	typename Idx = std::size_t
+>
+class StreamingLessThanCounter {
+public:
+	/// Construct the workspace for Y given by random-access iterator range
+	/// [y_begin, y_end).
+	/// Parameter k >= 3 is the parameter for the algorithm described in the
+	/// paper.
+	StreamingLessThanCounter(YI y_begin, YI y_end, Idx k = 3)
+		: counter(y_begin, y_end, k),
+		  m((Idx)(y_end - y_begin)),
+		  state(LessThanCounter<YI, Idx>::startScan(0)),
+		  finished(false)
+	{ }
+	
+	/// Append the characters in range [ptr, ptr + len) to the end of X.
+	/// Runs in amortized O(len) time.
+	void feed(const C* ptr, std::size_t len) {
+		assert(!finished);
+		
+		// Add the characters in pieces, so that the buffer size stays
+		// bounded.
+		std::size_t piece_size = std::max((std::size_t)m, (std::size_t)1 << 16);
+		while(len != 0) {
+			std::size_t piece = std::min(len, piece_size);
+			window.insert(window.end(), ptr, ptr + piece);
+			ptr += piece;
+			len -= piece;
+			
+			// Process the suffixes for which the first m characters are known.
+			// The jumps of the scan depend only on the known common prefix, so
+			// they may pass the last such suffix up to the end of the window,
+			// and the common prefix is kept in the state for the next piece.
+			Idx size = (Idx)window.size();
+			if(size >= m) {
+				counter.scan(window.begin(), window.end(), state, std::min(size, size - m + 1), size);
+			}
+			
+			// Drop the processed prefix of the window only when it is at least
+			// as long as the rest, so that the cost of moving the rest is
+			// amortized over the processed characters.
+			std::size_t consumed = (std::size_t)state.i;
+			if(consumed >= std::max((std::size_t)m, window.size() / 2)) {
+				window.erase(window.begin(), window.begin() + consumed);
+				state.i = 0;
+			}
+		}
+	}
+	
+	/// Return the count of suffixes of the part of X fed so far that are
+	/// lexicographically smaller than Y, that is, the count that finish would
+	/// return now. More characters may be fed afterwards, as the suffixes that
+	/// are not yet resolved are kept in the window. Runs in O(|Y|) time.
+	Idx count() const {
+		typename LessThanCounter<YI, Idx>::ScanState tail = state;
+		counter.scan(window.begin(), window.end(), tail, (Idx)window.size());
+		return tail.count;
+	}
+	
+	/// Mark the end of X and return the count of suffixes of X
+	/// lexicographically smaller than Y. No characters may be fed after
+	/// calling finish.
+	Idx finish() {
+		assert(!finished);
+		
+		Idx ret = count();
+		window.clear();
+		finished = true;
+		
+		return ret;
+	}
+	
+private:
+	LessThanCounter<YI, Idx> counter;
+	Idx m; ///< Length of Y.
+	
+	/// Characters of X starting from a processed prefix that is dropped once
+	/// it is long enough, followed by the suffixes not yet processed.
+	std::vector<C> window;
+	
+	/// Scan state, with index i relative to the start of window.
+	typename LessThanCounter<YI, Idx>::ScanState state;
+	
+	bool finished;
+};
+
+/// Equivalent to constructor of StreamingLessThanCounter of appropriate type.
+template <typename YI, typename Idx = std::size_t>
+StreamingLessThanCounter<YI, typename std::iterator_traits<YI>::value_type, Idx>
+makeStreamingLessThanCounter(YI y_begin, YI y_end, Idx k = 3) {
+	return StreamingLessThanCounter<
+		YI, typename std::iterator_traits<YI>::value_type, Idx
+	>(y_begin, y_end, k);
+}
+
+/// Workspace for maintaining the count of suffixes of an append-only string X
+/// lexicographically in range [Y, Z), where Y is assumed to be less than or
+/// equal to Z. Appending characters to X takes amortized time proportional to
+/// the number of characters appended (see StreamingLessThanCounter::feed),
+/// and the count can be queried at any time in O(|Y| + |Z|) time. Suffixes
+/// that started before the appended characters and could not yet be compared
+/// to Y or Z are accounted for correctly.
+/// See the documentation of StreamingLessThanCounter for more details.
+template <
+	typename YI, typename ZI,
+	typename C = typename std::iterator_traits<YI>::value_type,
+	typename Idx = std::size_t
+>
+class IncrementalRangeCounter {
+public:
+	/// Construct the workspace for Y and Z given by random-access iterator
+	/// ranges [y_begin, y_end) and [z_begin, z_end), and empty X.
+	/// Parameters ky, kz >= 3 are the parameters for the algorithm described in
+	/// the paper.
+	/// ky is used for bound Y and kz for bound Z.
+	IncrementalRangeCounter(
+		YI y_begin, YI y_end,
+		ZI z_begin, ZI z_end,
+		Idx ky = 3, Idx kz = 3
+	)
+		: y_counter(y_begin, y_end, ky),
+		  z_counter(z_begin, z_end, kz)
+	{ }
+	
+	/// Append the characters in range [ptr, ptr + len) to the end of X.
+	/// Runs in amortized O(len) time.
+	void append(const C* ptr, std::size_t len) {
+		z_counter.feed(ptr, len);
+		y_counter.feed(ptr, len);
+	}
+	
+	/// Return the count of suffixes of current X lexicographically in range
+	/// [Y, Z).
+	Idx count() const {
+		return z_counter.count() - y_counter.count();
+	}
+	
+private:
+	StreamingLessThanCounter<YI, C, Idx> y_counter; ///< Counter for range ["", Y).
+	StreamingLessThanCounter<ZI, C, Idx> z_counter; ///< Counter for range ["", Z).
+};
+
+/// Equivalent to constructor of IncrementalRangeCounter of appropriate type.
+template <typename YI, typename ZI, typename Idx = std::size_t>
+IncrementalRangeCounter<YI, ZI, typename std::iterator_traits<YI>::value_type, Idx>
+makeIncrementalRangeCounter(
+	YI y_begin, YI y_end,
+	ZI z_begin, ZI z_end,
+	Idx ky = 3, Idx kz = 3
+) {
+	return IncrementalRangeCounter<
+		YI, ZI, typename std::iterator_traits<YI>::value_type, Idx
+	>(y_begin, y_end, z_begin, z_end, ky, kz);
+}
+
+}
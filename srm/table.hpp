@@ -3,10 +3,13 @@
 #include "util.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include <cassert>
+#include <utility>
 
 // Algorithm for creating lookup table of string range matches.
 
@@ -100,10 +103,143 @@ void computeLessThanMatchTableToIterator(
 	);
 }
 
-/// Compute the same boolean vector as computeRangeMatchTable to random-access
-/// iterator range [b_begin, b_begin + n) where n is the length of string X. Uses
-/// std::copy for copying ranges. Current implementation uses |X| bits of extra
-/// space.
+/// Generator of the boolean vector of computeLessThanMatchTable in order, 64
+/// values at a time. Instead of copying earlier values of the output, the
+/// copied values are taken from the table of the suffixes of Y less than Y:
+/// the values are copied only for suffixes whose comparison to Y is resolved
+/// within the known common prefix of X and Y, and therefore they are equal
+/// to the values for the corresponding suffixes of Y. Thus the generator does
+/// not need the earlier output, and uses |Y| bits of extra space for the
+/// table of Y, which is shared by the copies of the generator. The generation
+/// can also be started from any position with restart. Strings X and Y must
+/// stay alive and unchanged throughout the lifetime of the generator.
+template <typename XI, typename YI, typename Idx = std::size_t>
+class LessThanMatchTableGenerator {
+public:
+	/// Start generating the table of X and Y given by random-access iterator
+	/// ranges [x_begin, x_end) and [y_begin, y_end).
+	LessThanMatchTableGenerator(XI x_begin, XI x_end, YI y_begin, YI y_end)
+		: x_begin(x_begin),
+		  x_end(x_end),
+		  y_begin(y_begin),
+		  y_end(y_end),
+		  y_table(std::make_shared<std::vector<std::uint64_t>>(
+			packedWordCount((std::size_t)(y_end - y_begin))
+		  )),
+		  i(0),
+		  ms{0, 0, 0},
+		  copy_src(0),
+		  copy_size(0)
+	{
+		std::uint64_t* words = y_table->data();
+		auto set_output = [words](Idx i, bool val) {
+			writePackedBits(words, (std::size_t)i, 1, (std::uint64_t)val);
+		};
+		auto copy_output = [words](Idx i, Idx j, Idx s) {
+			copyPackedBits(words, (std::size_t)i, (std::size_t)j, (std::size_t)s);
+		};
+		computeLessThanMatchTable<YI, YI, decltype(set_output), decltype(copy_output), Idx>(
+			y_begin, y_end,
+			y_begin, y_end,
+			set_output, copy_output
+		);
+	}
+	
+	/// Restart the generation from the value of the suffix of X starting at
+	/// index start.
+	void restart(Idx start) {
+		i = start;
+		ms = MSTuple<Idx>{0, 0, 0};
+		copy_size = 0;
+	}
+	
+	/// Return the next 64 values of the table as the bits of a word, from the
+	/// least significant bit. The bits after the end of the table are zero.
+	std::uint64_t next() {
+		std::uint64_t word = 0;
+		std::size_t filled = 0;
+		while(filled < 64) {
+			if(copy_size == 0) {
+				if(i == (Idx)(x_end - x_begin)) break;
+				word |= (std::uint64_t)step() << filled;
+				++filled;
+			} else {
+				std::size_t t = std::min(copy_size, 64 - filled);
+				word |= readPackedBits(y_table->data(), copy_src, t) << filled;
+				filled += t;
+				copy_src += t;
+				copy_size -= t;
+			}
+		}
+		return word;
+	}
+	
+private:
+	XI x_begin;
+	XI x_end;
+	YI y_begin;
+	YI y_end;
+	
+	/// Table of the suffixes of Y less than Y as a packed bitvector.
+	std::shared_ptr<std::vector<std::uint64_t>> y_table;
+	
+	/// Starting index and maximal suffix of the known match of Y of the next
+	/// suffix of X to process, as in computeLessThanMatchTable.
+	Idx i;
+	MSTuple<Idx> ms;
+	
+	/// Range of y_table still to be output before the value of suffix i.
+	std::size_t copy_src;
+	std::size_t copy_size;
+	
+	/// Return the value of suffix i and advance to the next suffix to process,
+	/// setting the values between them to be copied from y_table.
+	bool step() {
+		// Convenience functions to index X and Y.
+		auto X = [this](Idx i) { return *(x_begin + i); };
+		auto Y = [this](Idx i) { return *(y_begin + i); };
+		Idx n = (Idx)(x_end - x_begin);
+		Idx m = (Idx)(y_end - y_begin);
+		
+		while(i + ms.l < n && ms.l < m && X(i + ms.l) == Y(ms.l)) {
+			ms = updateMS<decltype(Y), Idx>(Y, ms);
+		}
+		bool val = ms.l < m && (i + ms.l == n || X(i + ms.l) < Y(ms.l));
+		
+		Idx h;
+		if(
+			ms.p > 0 &&
+			ms.p <= ms.l / 3 &&
+			std::equal(y_begin, y_begin + ms.s, y_begin + ms.p)
+		) {
+			h = ms.p;
+			ms.l -= ms.p;
+		} else {
+			h = ms.l / 3 + 1;
+			ms = MSTuple<Idx>{0, 0, 0};
+		}
+		copy_src = 1;
+		copy_size = (std::size_t)(h - 1);
+		i += h;
+		
+		return val;
+	}
+};
+
+/// Computes a boolean vector which determines for each suffix of string X
+/// whether it is lexicographically in range [Y, Z). Strings X, Y and Z are
+/// given as random-access iterator ranges, and the vector is written to
+/// random-access iterator range [b_begin, b_begin + n) where n is the length
+/// of string X.
+///
+/// The tables of the suffixes less than Y and less than Z are generated
+/// simultaneously a word at a time by LessThanMatchTableGenerator and combined
+/// as (less than Z) and not (less than Y), passing over X only once. Uses
+/// O(|Y| + |Z|) bits of extra space for the tables of Y and Z in the
+/// generators. Constant extra space as in computeLessThanMatchTable is not
+/// possible here, as it copies values from the earlier output, but a single
+/// bit of range output cannot tell apart the three cases less than Y, in
+/// range and not less than Z that the copies for Y and Z need.
 template <
 	typename XI, typename YI, typename ZI,
 	typename BI,
@@ -112,22 +248,65 @@ template <
 void computeRangeMatchTableToIterator(
 	XI x_begin, XI x_end,
 	YI y_begin, YI y_end,
-	ZI z_begin, YI z_end,
+	ZI z_begin, ZI z_end,
 	BI b_begin
 ) {
 	Idx n = (Idx)(x_end - x_begin);
 	
-	computeLessThanMatchTableToIterator<XI, YI, BI, Idx>(
-		x_begin, x_end, y_begin, y_end, b_begin
-	);
+	LessThanMatchTableGenerator<XI, YI, Idx> y_gen(x_begin, x_end, y_begin, y_end);
+	LessThanMatchTableGenerator<XI, ZI, Idx> z_gen(x_begin, x_end, z_begin, z_end);
 	
-	std::vector<bool> tmp(n);
-	computeLessThanMatchTableToIterator<XI, ZI, std::vector<bool>::iterator, Idx>(
-		x_begin, x_end, z_begin, z_end, tmp.begin()
-	);
+	for(Idx i = 0; i < n; i += 64) {
+		std::uint64_t word = z_gen.next() & ~y_gen.next();
+		Idx s = std::min((Idx)64, n - i);
+		for(Idx t = 0; t < s; ++t) {
+			*(b_begin + i + t) = (bool)((word >> t) & 1);
+		}
+	}
+}
+
+/// Computes for each suffix of string X the index of its bucket, when the
+/// buckets are delimited by boundary strings B_1 < B_2 < ... < B_b as in
+/// BucketCounter: the index of the bucket of a suffix is the number of
+/// boundaries less than or equal to it. String X is given as random-access
+/// iterator range [x_begin, x_end) and the boundaries as a vector of
+/// random-access iterator ranges sorted in increasing lexicographical order.
+/// The bucket indices are written to random-access iterator range
+/// [b_begin, b_begin + n) where n is the length of string X.
+///
+/// Runs computeLessThanMatchTable once for each boundary, using the output
+/// range itself to store the tables, and therefore uses constant extra space.
+template <typename XI, typename BI, typename OI, typename Idx = std::size_t>
+void computeBucketTableToIterator(
+	XI x_begin, XI x_end,
+	const std::vector<std::pair<BI, BI>>& boundaries,
+	OI b_begin
+) {
+	Idx n = (Idx)(x_end - x_begin);
 	
 	for(Idx i = 0; i < n; ++i) {
-		*(b_begin + i) = (bool)*(b_begin + i) != tmp[i];
+		*(b_begin + i) = 0;
+	}
+	
+	// Before processing boundary B_j, the output for each suffix is the
+	// minimum of its bucket index and j - 1. Because the boundaries are
+	// sorted, a suffix that is not less than B_j has value j - 1, and the
+	// value of a suffix already processed is j exactly when it is not less
+	// than B_j.
+	for(std::size_t j = 1; j <= boundaries.size(); ++j) {
+		auto set_output = [b_begin, j](Idx i, bool val) {
+			if(!val) *(b_begin + i) = j;
+		};
+		auto copy_output = [b_begin, j](Idx i, Idx src, Idx s) {
+			for(Idx t = 0; t < s; ++t) {
+				if(*(b_begin + src + t) == j) *(b_begin + i + t) = j;
+			}
+		};
+		computeLessThanMatchTable<XI, BI, decltype(set_output), decltype(copy_output), Idx>(
+			x_begin, x_end,
+			boundaries[j - 1].first, boundaries[j - 1].second,
+			set_output, copy_output
+		);
 	}
 }
 
@@ -1,6 +1,23 @@
 #pragma once
 
 #include <cstddef>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
 
 // Utility functions used in implementing string range matching algorithms.
 
@@ -49,4 +66,392 @@ MSTuple<Idx> updateMS(F Y, MSTuple<Idx> ms) {
 	return ms;
 }
 
+/// Return floor(log2(x)) for x >= 1.
+template <typename Idx>
+int floorLog2(Idx x) {
+#if defined(__GNUC__)
+	return std::numeric_limits<unsigned long long>::digits - 1 - __builtin_clzll((unsigned long long)x);
+#else
+	int ret = 0;
+	while(x >>= 1) ++ret;
+	return ret;
+#endif
+}
+
+/// Return the number of set bits in x.
+inline int popCount(std::uint64_t x) {
+#if defined(__GNUC__)
+	return __builtin_popcountll((unsigned long long)x);
+#else
+	int ret = 0;
+	for(; x != 0; x &= x - 1) ++ret;
+	return ret;
+#endif
+}
+
+/// Return the position of the set bit of rank k in word, i.e. the (k + 1)th
+/// least significant set bit, where k < popCount(word).
+inline int selectInWord(std::uint64_t word, int k) {
+	assert(k < popCount(word));
+	for(; k != 0; --k) {
+		word &= word - 1;
+	}
+	return floorLog2(word & (~word + 1));
+}
+
+/// Vector-like container of at most N elements of type T, stored inline in
+/// the object without heap allocations.
+template <typename T, std::size_t N>
+class InlineVector {
+public:
+	InlineVector()
+		: count(0)
+	{ }
+	
+	/// Maximum number of elements in the container.
+	static std::size_t capacity() {
+		return N;
+	}
+	
+	std::size_t size() const {
+		return count;
+	}
+	
+	const T* data() const {
+		return elems;
+	}
+	
+	const T& operator[](std::size_t i) const {
+		return elems[i];
+	}
+	
+	void push_back(const T& elem) {
+		assert(count < N);
+		elems[count++] = elem;
+	}
+	
+	void clear() {
+		count = 0;
+	}
+	
+private:
+	T elems[N];
+	std::size_t count;
+};
+
+/// Traits class for detecting random-access iterators to contiguous arrays of
+/// byte-sized characters (pointers, iterators of std::vector and iterators of
+/// std::string), for which matchLength compares several characters at once.
+/// Only std::string is checked of the string types, as std::basic_string of
+/// other character types needs a std::char_traits specialization that the
+/// standard library does not necessarily provide.
+template <typename I>
+struct ContiguousBytes {
+	typedef typename std::iterator_traits<I>::value_type T;
+	static const bool byte_sized =
+		sizeof(T) == 1 && std::is_integral<T>::value && !std::is_same<T, bool>::value;
+	
+	// Character type used for looking up the container iterator types.
+	typedef typename std::conditional<byte_sized, T, char>::type C;
+	
+	static const bool value = byte_sized && (
+		std::is_pointer<I>::value ||
+		std::is_same<I, std::string::iterator>::value ||
+		std::is_same<I, std::string::const_iterator>::value ||
+		std::is_same<I, typename std::vector<C>::iterator>::value ||
+		std::is_same<I, typename std::vector<C>::const_iterator>::value
+	);
+};
+
+/// Return the length of the longest common prefix of byte arrays x and y,
+/// comparing at most max bytes. Uses the widest available SIMD instructions
+/// to compare 64, 32 or 16 bytes at once, and otherwise compares 8 bytes at
+/// once using 64-bit integers.
+inline std::size_t matchLengthBytes(
+	const unsigned char* x,
+	const unsigned char* y,
+	std::size_t max
+) {
+	std::size_t l = 0;
+#if defined(__AVX512BW__)
+	while(l + 64 <= max) {
+		__m512i a = _mm512_loadu_si512((const void*)(x + l));
+		__m512i b = _mm512_loadu_si512((const void*)(y + l));
+		std::uint64_t diff = ~(std::uint64_t)_mm512_cmpeq_epi8_mask(a, b);
+		if(diff != 0) return l + __builtin_ctzll(diff);
+		l += 64;
+	}
+#endif
+#if defined(__AVX2__)
+	while(l + 32 <= max) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(x + l));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(y + l));
+		std::uint32_t diff = ~(std::uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+		if(diff != 0) return l + __builtin_ctz(diff);
+		l += 32;
+	}
+#endif
+#if defined(__SSE2__)
+	while(l + 16 <= max) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(x + l));
+		__m128i b = _mm_loadu_si128((const __m128i*)(y + l));
+		std::uint32_t diff = 0xFFFF & ~(std::uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+		if(diff != 0) return l + __builtin_ctz(diff);
+		l += 16;
+	}
+#endif
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	while(l + 8 <= max) {
+		std::uint64_t a;
+		std::uint64_t b;
+		std::memcpy(&a, x + l, 8);
+		std::memcpy(&b, y + l, 8);
+		if(a != b) return l + __builtin_ctzll(a ^ b) / 8;
+		l += 8;
+	}
+#endif
+	while(l < max && x[l] == y[l]) ++l;
+	return l;
+}
+
+template <typename XI, typename YI, typename Idx>
+Idx matchLength_(XI x, YI y, Idx max, std::false_type) {
+	Idx l = 0;
+	while(l < max && *(x + l) == *(y + l)) ++l;
+	return l;
+}
+
+template <typename XI, typename YI, typename Idx>
+Idx matchLength_(XI x, YI y, Idx max, std::true_type) {
+	// Most mismatches are at the first character, so check it separately.
+	if(max == 0 || !(*x == *y)) return 0;
+	return (Idx)matchLengthBytes(
+		reinterpret_cast<const unsigned char*>(&*x),
+		reinterpret_cast<const unsigned char*>(&*y),
+		(std::size_t)max
+	);
+}
+
+/// Return the length of the longest common prefix of the strings starting at
+/// random-access iterators x and y, comparing at most max characters.
+/// The characters should be comparable with operator ==. If both iterators
+/// point to contiguous arrays of the same byte-sized character type (see
+/// ContiguousBytes), the characters are compared several at a time.
+template <typename XI, typename YI, typename Idx>
+Idx matchLength(XI x, YI y, Idx max) {
+	typedef std::integral_constant<
+		bool,
+		ContiguousBytes<XI>::value && ContiguousBytes<YI>::value &&
+		std::is_same<
+			typename std::iterator_traits<XI>::value_type,
+			typename std::iterator_traits<YI>::value_type
+		>::value
+	> Fast;
+	return matchLength_(x, y, max, Fast());
+}
+
+/// Traits class for detecting output functions of the reporting algorithms
+/// that also accept runs of matches as output(start, step, count). The output
+/// type must opt in by defining the member type RunOutputTag; merely being
+/// callable with three indices is not enough, as e.g. the results of std::bind
+/// and functions with defaulted parameters would then silently drop the step
+/// and count.
+template <typename F, typename Idx>
+struct AcceptsRuns {
+	template <typename G>
+	static std::true_type test(typename G::RunOutputTag*);
+	template <typename G>
+	static std::false_type test(...);
+	
+	static const bool value = decltype(test<F>(nullptr))::value;
+};
+
+template <typename Idx, typename F>
+void outputRun_(F& output, Idx start, Idx step, Idx count, std::false_type) {
+	for(Idx t = 0; t < count; ++t) {
+		output(start);
+		start += step;
+	}
+}
+
+template <typename Idx, typename F>
+void outputRun_(F& output, Idx start, Idx step, Idx count, std::true_type) {
+	if(count != 0) output(start, step, count);
+}
+
+/// Pass the arithmetic progression of matches start, start + step, ...,
+/// start + (count - 1) * step to function output, as a single call
+/// output(start, step, count) if output accepts it, and otherwise one by one.
+template <typename Idx, typename F>
+void outputRun(F& output, Idx start, Idx step, Idx count) {
+	outputRun_<Idx>(
+		output, start, step, count,
+		std::integral_constant<bool, AcceptsRuns<F, Idx>::value>()
+	);
+}
+
+// The packed bitvectors are stored in arrays of 64-bit words, with bit i of the
+// bitvector in bit i % 64 (counting from the least significant bit) of word
+// i / 64.
+
+/// Return the number of words in a packed bitvector of n bits.
+inline std::size_t packedWordCount(std::size_t n) {
+	return (n + 63) / 64;
+}
+
+/// Return bit i of packed bitvector words.
+inline bool getPackedBit(const std::uint64_t* words, std::size_t i) {
+	return (words[i / 64] >> (i % 64)) & 1;
+}
+
+/// Return a word with the s lowest bits set, for s <= 64.
+inline std::uint64_t lowBitMask(std::size_t s) {
+	return s >= 64 ? ~(std::uint64_t)0 : ((std::uint64_t)1 << s) - 1;
+}
+
+/// Return the s <= 64 bits of packed bitvector words starting from bit i in
+/// the lowest bits of the result. Only the words containing the bits are
+/// accessed.
+inline std::uint64_t readPackedBits(const std::uint64_t* words, std::size_t i, std::size_t s) {
+	std::size_t w = i / 64;
+	std::size_t o = i % 64;
+	std::uint64_t val = words[w] >> o;
+	if(o != 0 && o + s > 64) val |= words[w + 1] << (64 - o);
+	return val & lowBitMask(s);
+}
+
+/// Set the s <= 64 bits of packed bitvector words starting from bit i to the
+/// lowest bits of val, which must not have other bits set.
+inline void writePackedBits(std::uint64_t* words, std::size_t i, std::size_t s, std::uint64_t val) {
+	std::size_t w = i / 64;
+	std::size_t o = i % 64;
+	if(o == 0 && s == 64) {
+		words[w] = val;
+		return;
+	}
+	std::uint64_t mask = lowBitMask(s);
+	words[w] = (words[w] & ~(mask << o)) | (val << o);
+	if(o + s > 64) {
+		words[w + 1] = (words[w + 1] & ~(mask >> (64 - o))) | (val >> (64 - o));
+	}
+}
+
+/// Copy the bits [src, src + s) of packed bitvector words to [dst, dst + s),
+/// where src + s <= dst, that is, the source is before the destination and
+/// they are disjoint. The destination is first aligned to a word boundary,
+/// after which the bits are moved a whole word at a time, using shifts to
+/// combine the source words if the source is not aligned. As the source is
+/// before the destination, it cannot be overwritten before it has been read.
+inline void copyPackedBits(std::uint64_t* words, std::size_t dst, std::size_t src, std::size_t s) {
+	if(s == 0) return;
+	
+	std::size_t t = std::min(s, 64 - dst % 64);
+	writePackedBits(words, dst, t, readPackedBits(words, src, t));
+	dst += t;
+	src += t;
+	s -= t;
+	
+	while(s >= 64) {
+		words[dst / 64] = readPackedBits(words, src, 64);
+		dst += 64;
+		src += 64;
+		s -= 64;
+	}
+	
+	if(s != 0) writePackedBits(words, dst, s, readPackedBits(words, src, s));
+}
+
+/// Length of the blocks of X in fused scans, chosen such that a block stays
+/// in cache while all the scans are advanced over it.
+inline std::size_t scanBlockSize() {
+	return 1 << 16;
+}
+
+/// Returns the starting index of part t when splitting range [0, n) into
+/// part_count parts of roughly equal size. Returns n for t == part_count.
+template <typename Idx>
+Idx splitPoint(Idx n, Idx part_count, Idx t) {
+	return (n / part_count) * t + std::min(t, n % part_count);
+}
+
+/// Split range [0, n) into at most thread_count chunks of roughly equal size,
+/// call count_chunk(Idx begin, Idx end) for each chunk in a separate thread
+/// and return the sum of the results.
+template <typename Idx, typename F>
+Idx sumChunksInParallel(Idx n, unsigned thread_count, F count_chunk) {
+	if((Idx)thread_count > n) thread_count = (unsigned)n;
+	if(thread_count <= 1) return count_chunk(0, n);
+	
+	std::vector<Idx> counts(thread_count);
+	auto run = [&](unsigned t) {
+		counts[t] = count_chunk(
+			splitPoint<Idx>(n, thread_count, t),
+			splitPoint<Idx>(n, thread_count, t + 1)
+		);
+	};
+	
+	std::vector<std::thread> threads;
+	for(unsigned t = 1; t < thread_count; ++t) {
+		threads.emplace_back(run, t);
+	}
+	run(0);
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+	
+	Idx count = 0;
+	for(Idx c : counts) {
+		count += c;
+	}
+	return count;
+}
+
+/// Call task(i) for each i in [0, task_count) using thread_count threads.
+/// The tasks are initially split into contiguous ranges of roughly equal
+/// size for the threads, and a thread that has run out of tasks steals tasks
+/// from the ranges of the other threads.
+template <typename F>
+void runTasksInParallel(std::size_t task_count, unsigned thread_count, F task) {
+	if((std::size_t)thread_count > task_count) thread_count = (unsigned)task_count;
+	if(thread_count <= 1) {
+		for(std::size_t i = 0; i < task_count; ++i) {
+			task(i);
+		}
+		return;
+	}
+	
+	// The ranges are padded to separate cache lines to avoid false sharing.
+	struct Range {
+		std::atomic<std::size_t> next;
+		std::size_t end;
+		char padding[64];
+	};
+	std::unique_ptr<Range[]> ranges(new Range[thread_count]);
+	for(unsigned t = 0; t < thread_count; ++t) {
+		ranges[t].next = splitPoint<std::size_t>(task_count, thread_count, t);
+		ranges[t].end = splitPoint<std::size_t>(task_count, thread_count, t + 1);
+	}
+	
+	auto run = [&](unsigned t) {
+		// Process the own range first, then steal from the others.
+		for(unsigned v = 0; v < thread_count; ++v) {
+			Range& range = ranges[(t + v) % thread_count];
+			while(true) {
+				std::size_t i = range.next.fetch_add(1);
+				if(i >= range.end) break;
+				task(i);
+			}
+		}
+	};
+	
+	std::vector<std::thread> threads;
+	for(unsigned t = 1; t < thread_count; ++t) {
+		threads.emplace_back(run, t);
+	}
+	run(0);
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
 }
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <ctime>
+#include <chrono>
 
 using namespace std;
 
@@ -77,3 +79,51 @@ void fail(T... msg) {
 	cerr << "FAIL: ";
 	fail_(msg...);
 }
+
+/// Gets the current processor time in seconds. Linux specific, implement for
+/// other platforms.
+double getCPUTime() {
+	timespec t;
+	if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t)) {
+		fail("Measuring CPU time failed.");
+	}
+	return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+
+class Timer {
+public:
+	Timer() {
+		reset();
+	}
+	
+	void reset() {
+		start = getCPUTime();
+	}
+	
+	double getElapsedTime() {
+		return getCPUTime() - start;
+	}
+	
+private:
+	double start;
+};
+
+/// Timer measuring wall clock time instead of processor time, for measuring
+/// multithreaded code and time spent waiting for I/O.
+class WallTimer {
+public:
+	WallTimer() {
+		reset();
+	}
+	
+	void reset() {
+		start = std::chrono::steady_clock::now();
+	}
+	
+	double getElapsedTime() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	
+private:
+	std::chrono::steady_clock::time_point start;
+};